@@ -0,0 +1,69 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "chip8.h"
+
+#define FUZZ_FRAMES             30
+#define FUZZ_CYCLES_PER_FRAME   10
+#define FUZZ_HEADER_SIZE        3
+///< One input in this many also checks the incremental hash against a full
+///< rehash, which walks all of memory. Build with -DFUZZ_REHASH_EVERY=1 to check every input
+#ifndef FUZZ_REHASH_EVERY
+#define FUZZ_REHASH_EVERY       16
+#endif
+
+/**
+ * libFuzzer entry point. Byte 0 picks the quirk profile, bytes 1-2 are the
+ * held keys and the rest is loaded as the ROM. The ROM runs for a fixed
+ * number of frames on the fused and the single step loop side by side, and
+ * the run aborts if they disagree. The rest of byte 0 decides whether the
+ * input also checks that the incremental hash has not drifted, so the
+ * check stays deterministic per input while most execs skip its cost.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static chip8 fused;
+    static chip8 reference;
+
+    if(size < FUZZ_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    QUIRKS_t quirks = (QUIRKS_t)(data[0] % NUM_QUIRKS);
+    unsigned short keys = data[1] | (data[2] << 8);
+    const uint8_t *rom = data + FUZZ_HEADER_SIZE;
+    size_t romSize = size - FUZZ_HEADER_SIZE;
+
+    if(!fused.loadRom(rom, romSize, quirks) || !reference.loadRom(rom, romSize, quirks))
+    {
+        return 0;
+    }
+    fused.setVerbose(false);
+    reference.setVerbose(false);
+    fused.setFusion(true);
+    reference.setFusion(false);
+    fused.seedRandom(1);
+    reference.seedRandom(1);
+
+    for(int k = 0; k < KEYPAD_SIZE; k++)
+    {
+        fused.key[k] = reference.key[k] = (keys >> k) & 1;
+    }
+
+    for(int f = 0; f < FUZZ_FRAMES; f++)
+    {
+        fused.emulateFrame(FUZZ_CYCLES_PER_FRAME);
+        reference.emulateFrame(FUZZ_CYCLES_PER_FRAME);
+        if(fused.stateHash() != reference.stateHash())
+        {
+            abort();
+        }
+    }
+
+    if((data[0] / NUM_QUIRKS) % FUZZ_REHASH_EVERY == 0 && fused.stateHash() != fused.computeStateHash())
+    {
+        abort();
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <chrono>
+
+/**
+ * Driver for chip8_fuzz.cpp when libFuzzer is not available.
+ * With file arguments each file is run once, otherwise random inputs are
+ * generated for a while and the exec rate is printed.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define RANDOM_RUNS         20000
+#define RANDOM_MAX_SIZE     512
+
+int main(int argc, char** argv)
+{
+	if(argc > 1)
+	{
+		for(int i = 1; i < argc; i++)
+		{
+			FILE *fptr = fopen(argv[i], "rb");
+			if(fptr == NULL)
+			{
+				fprintf(stderr, "File Error: %s\n", argv[i]);
+				return 1;
+			}
+			std::vector<uint8_t> input;
+			int c;
+			while((c = fgetc(fptr)) != EOF)
+			{
+				input.push_back((uint8_t)c);
+			}
+			fclose(fptr);
+
+			LLVMFuzzerTestOneInput(input.empty() ? NULL : &input[0], input.size());
+			printf("%s: ok\n", argv[i]);
+		}
+		return 0;
+	}
+
+	std::vector<uint8_t> input(RANDOM_MAX_SIZE);
+	unsigned int state = 0x12345678;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for(int run = 0; run < RANDOM_RUNS; run++)
+	{
+		size_t size = 0;
+		state = state * 1103515245 + 12345;
+		size = (state >> 8) % RANDOM_MAX_SIZE;
+		for(size_t i = 0; i < size; i++)
+		{
+			state = state * 1103515245 + 12345;
+			input[i] = (uint8_t)(state >> 16);
+		}
+		LLVMFuzzerTestOneInput(&input[0], size);
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%d runs in %.2f s, %.0f execs/s\n", RANDOM_RUNS, seconds, RANDOM_RUNS / seconds);
+	return 0;
+}
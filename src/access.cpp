@@ -0,0 +1,103 @@
+#include "access.h"
+
+///< Opcode names indexed by OPCODE_t
+static const char *opcodeNames[NUM_OPCODES] = {
+    "0NNN", "00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+    "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE", "9XY0",
+    "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+    "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65",
+    "00CN", "00FB", "00FC", "00FD", "00FE", "00FF", "FX30", "FX75", "FX85",
+    "00DN", "5XY2", "5XY3", "F000", "FN01", "F002", "FX3A"
+};
+
+template <class Q>
+static bool hasSuperChip()
+{
+    return Q::superChip;
+}
+
+chip8Decoder::chip8Decoder(QUIRKS_t quirks)
+    : profile(quirks)
+{
+    ///< DXY0 only draws a 16x16 sprite where SUPER-CHIP opcodes exist
+    switch(quirks)
+    {
+        case QUIRKS_VIP:    superChip = hasSuperChip<quirksVip>(); break;
+        case QUIRKS_CHIP48: superChip = hasSuperChip<quirksChip48>(); break;
+        case QUIRKS_SCHIP:  superChip = hasSuperChip<quirksSchip>(); break;
+        case QUIRKS_XOCHIP: superChip = hasSuperChip<quirksXoChip>(); break;
+        default:            superChip = hasSuperChip<quirksModern>(); break;
+    }
+}
+
+const char *chip8Decoder::opcodeName(int op)
+{
+    return (op >= 0 && op < NUM_OPCODES) ? opcodeNames[op] : "unknown";
+}
+
+int chip8Decoder::decode(unsigned short opcode) const
+{
+    ///< The interpreter's own decode, so the two cannot disagree
+    return chip8::decodeOpcode(opcode, profile);
+}
+
+bool chip8Decoder::supports(int op) const
+{
+    if(op < 0 || op >= NUM_OPCODES)
+    {
+        return false;
+    }
+    ///< The opcode's name with its operands zeroed is an instance of it
+    unsigned short opcode = 0;
+    for(const char *c = opcodeNames[op]; *c != '\0'; c++)
+    {
+        unsigned int digit = 0;
+        if(*c >= '0' && *c <= '9')
+        {
+            digit = *c - '0';
+        }
+        else if(*c >= 'A' && *c <= 'F')
+        {
+            digit = *c - 'A' + 10;
+        }
+        opcode = (opcode << 4) | digit;
+    }
+    return decode(opcode) == op;
+}
+
+chip8Access chip8Decoder::next(const chip8 &c8) const
+{
+    chip8Access a;
+    a.opcode = (c8.memory[c8.pc] << 8) | c8.memory[c8.pc + 1];
+    a.op = decode(a.opcode);
+    a.read.start = a.write.start = c8.I;
+    a.read.length = a.write.length = 0;
+
+    unsigned int x = (a.opcode & 0x0F00) >> 8;
+    unsigned int y = (a.opcode & 0x00F0) >> 4;
+
+    ///< Same accesses the handler is about to make
+    switch(a.op)
+    {
+        case OPCODE_DXYN:
+        {
+            ///< Bytes the sprite covers, one sprite per selected plane
+            unsigned int height = a.opcode & 0x000F;
+            unsigned int length = (superChip && height == 0) ? 32 : height;
+            unsigned int planes = (c8.planeMask & 0x1) + ((c8.planeMask >> 1) & 0x1);
+            a.read.length = length * planes;
+        }
+        break;
+        case OPCODE_FX33: a.write.length = 3; break;
+        case OPCODE_FX55: a.write.length = x + 1; break;
+        case OPCODE_FX65: a.read.length = x + 1; break;
+        case OPCODE_5XY2: a.write.length = (x > y ? x - y : y - x) + 1; break;
+        case OPCODE_5XY3: a.read.length = (x > y ? x - y : y - x) + 1; break;
+        case OPCODE_F002: a.read.length = AUDIO_PATTERN_SIZE; break;
+        case OPCODE_F000: ///< The NNNN operand word
+            a.read.start = c8.pc + 2;
+            a.read.length = 2;
+        break;
+    }
+    return a;
+}
@@ -0,0 +1,45 @@
+#ifndef ACCESS_H
+#define ACCESS_H
+
+#include "chip8.h"
+
+///< Bytes an instruction touches from start on, wrapping like memory does
+struct accessRange
+{
+    unsigned int start;
+    unsigned int length;        ///< 0 when nothing is touched
+};
+
+///< The next instruction and the memory it is about to use
+struct chip8Access
+{
+    unsigned short opcode;
+    int op;                     ///< OPCODE_t, -1 for unknown opcodes
+    accessRange read;           ///< Sprites, FX65, 5XY3, F002 and the F000 operand
+    accessRange write;          ///< FX33, FX55 and 5XY2
+};
+
+/**
+ * Decodes the instruction at a machine's program counter without running
+ * it. Shared by the debugger and the profiler so both see the same
+ * accesses. Opcodes are decoded by chip8::decodeOpcode, the interpreter's
+ * own decode tree; which opcodes exist is a property of the quirk profile,
+ * so a decoder is built for one.
+ */
+class chip8Decoder
+{
+    public:
+        explicit chip8Decoder(QUIRKS_t quirks);
+
+        int decode(unsigned short opcode) const;
+        ///< False for opcodes the profile does not have, e.g. XO-CHIP ones on schip
+        bool supports(int op) const;
+        chip8Access next(const chip8 &c8) const;
+        static const char *opcodeName(int op);
+
+    private:
+        QUIRKS_t profile;
+        bool superChip;
+};
+
+#endif // ACCESS_H
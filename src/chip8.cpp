@@ -3,49 +3,69 @@
 #include <string.h>
 #include <stdbool.h>
 #include <time.h>
+#include <limits.h>
 #include "chip8.h"
+#include "chip8_c.h"
+#include "romfile.h"
 #include <functional>
+#include <new>
 #include <iostream>
 
-typedef enum {
-    OPCODE_ONNN,
-    OPCODE_00E0,
-    OPCODE_00EE,
-    OPCODE_1NNN,
-    OPCODE_2NNN,
-    OPCODE_3XNN,
-    OPCODE_4XNN,
-    OPCODE_5XY0,
-    OPCODE_6XNN,
-    OPCODE_7XNN,
-    OPCODE_8XY0,
-    OPCODE_8XY1,
-    OPCODE_8XY2,
-    OPCODE_8XY3,
-    OPCODE_8XY4,
-    OPCODE_8XY5,
-    OPCODE_8XY6,
-    OPCODE_8XY7,
-    OPCODE_8XYE,
-    OPCODE_9XY0,
-    OPCODE_ANNN,
-    OPCODE_BNNN,
-    OPCODE_CXNN,
-    OPCODE_DXYN,
-    OPCODE_EX9E,
-    OPCODE_EXA1,
-    OPCODE_FX07,
-    OPCODE_FX0A,
-    OPCODE_FX15,
-    OPCODE_FX18,
-    OPCODE_FX1E,
-    OPCODE_FX29,
-    OPCODE_FX33,
-    OPCODE_FX55,
-    OPCODE_FX65
-} OPCODE_t;
-
-const unsigned char chip8_fontset[80] =
+///< Unknown opcodes are reported unless the instance was made quiet
+#define LOG_UNKNOWN(...)    do { if(verbose) { printf(__VA_ARGS__); } } while(0)
+
+////////////////////////////////////////////////////////////////////
+///< State hashing
+///< Every memory byte and display word contributes mix(position, value)
+///< XORed into a running hash, zero bytes and words contribute
+///< nothing. A write only has to remove the old contribution and add
+///< the new one. The registers are small and change every cycle so
+///< they are folded in when the hash is requested.
+////////////////////////////////////////////////////////////////////
+static constexpr unsigned long long mixHash(unsigned long long x)
+{
+    ///< splitmix64 finalizer
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static constexpr unsigned long long memoryTerm(unsigned int address, unsigned char value)
+{
+    return value ? mixHash(((unsigned long long)address << 8) | value) : 0;
+}
+
+///< Position of a display word in the hash
+#define DISPLAY_WORD(plane, row, word)  ((((plane) * HIRES_HEIGHT) + (row)) * GFX_ROW_WORDS + (word))
+
+static constexpr unsigned long long displayTerm(unsigned int index, unsigned long long word)
+{
+    return word ? mixHash(mixHash(0x100000000ULL | index) ^ word) : 0;
+}
+
+/**
+ * COSMAC VIP machine cycles per instruction, fetch and decode included,
+ * indexed by OPCODE_t + 1 (slot 0 is an unknown opcode). Taken from timing
+ * the original interpreter, data dependent costs are averaged. SUPER-CHIP
+ * and XO-CHIP opcodes never ran on a VIP and get a nominal cost.
+ */
+static constexpr unsigned short vipCycles[NUM_OPCODES + 1] =
+{
+    23,                                 ///< unknown
+    23, 24, 23, 23, 23,                 ///< 0NNN 00E0 00EE 1NNN 2NNN
+    12, 12, 16, 6, 10,                  ///< 3XNN 4XNN 5XY0 6XNN 7XNN
+    44, 44, 44, 44, 44, 44, 44, 44, 44, ///< 8XY0-8XYE
+    16, 12, 23, 36, 22,                 ///< 9XY0 ANNN BNNN CXNN DXYN
+    16, 16,                             ///< EX9E EXA1
+    10, 10, 10, 10, 19, 20,             ///< FX07 FX0A FX15 FX18 FX1E FX29
+    204, 133, 133,                      ///< FX33 FX55 FX65
+    23, 23, 23, 23, 23, 23,             ///< 00CN 00FB 00FC 00FD 00FE 00FF
+    23, 23, 23,                         ///< FX30 FX75 FX85
+    23, 23, 23, 23, 23, 23, 23          ///< 00DN 5XY2 5XY3 F000 FN01 F002 FX3A
+};
+
+static constexpr unsigned char chip8_fontset[80] =
 { 
   0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
   0x20, 0x60, 0x20, 0x20, 0x70, // 1
@@ -65,6 +85,145 @@ const unsigned char chip8_fontset[80] =
   0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+///< SUPER-CHIP 8x10 font, loaded right after the small font
+#define BIGFONT_START   0x50
+
+static constexpr unsigned char chip8_bigfontset[160] =
+{
+  0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+  0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+  0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+  0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+  0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+  0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+  0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+  0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+  0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+  0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+  0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+  0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+///< Both fonts as they sit at the bottom of a freshly initialized machine
+#define FONT_AREA_SIZE  (BIGFONT_START + sizeof(chip8_bigfontset))
+
+struct fontArea
+{
+    unsigned char bytes[FONT_AREA_SIZE];
+    unsigned long long hash;    ///< Memory hash contribution of the font bytes
+};
+
+///< Laid out and hashed by the compiler, initialize() only copies the result
+static constexpr fontArea buildFontArea()
+{
+    fontArea area = {};
+    for(unsigned int i = 0; i < sizeof(chip8_fontset); i++)
+    {
+        area.bytes[i] = chip8_fontset[i];
+    }
+    for(unsigned int i = 0; i < sizeof(chip8_bigfontset); i++)
+    {
+        area.bytes[BIGFONT_START + i] = chip8_bigfontset[i];
+    }
+    for(unsigned int i = 0; i < FONT_AREA_SIZE; i++)
+    {
+        area.hash ^= memoryTerm(i, area.bytes[i]);
+    }
+    return area;
+}
+
+static constexpr fontArea bootFont = buildFontArea();
+
+
+chip8Memory &chip8Memory::operator=(const chip8Memory &other)
+{
+    if(this != &other)
+    {
+        setExtended(other.big != NULL);
+        memcpy(data, other.data, length);
+    }
+    return *this;
+}
+
+void chip8Memory::setExtended(bool extended)
+{
+    if(extended && big == NULL)
+    {
+        big = new unsigned char[XO_MEMORY_SIZE];
+        memcpy(big, small, MEMORY_SIZE);
+        memset(big + MEMORY_SIZE, 0, XO_MEMORY_SIZE - MEMORY_SIZE);
+        data = big;
+        length = XO_MEMORY_SIZE;
+        mask = XO_MEMORY_SIZE - 1;
+    }
+    else if(!extended && big != NULL)
+    {
+        memcpy(small, big, MEMORY_SIZE);
+        delete[] big;
+        big = NULL;
+        data = small;
+        length = MEMORY_SIZE;
+        mask = MEMORY_SIZE - 1;
+    }
+}
+
+void chip8Memory::clear()
+{
+    memset(data, 0, length);
+}
+
+const chip8::OpcodeMemFun chip8::opcodeArray[NUM_OPCODES] =
+{
+    &chip8::opcode_ONNN, &chip8::opcode_00E0,
+    &chip8::opcode_00EE, &chip8::opcode_1NNN,
+    &chip8::opcode_2NNN, &chip8::opcode_3XNN<quirksModern>,
+    &chip8::opcode_4XNN<quirksModern>, &chip8::opcode_5XY0<quirksModern>,
+    &chip8::opcode_6XNN, &chip8::opcode_7XNN,
+    &chip8::opcode_8XY0, &chip8::opcode_8XY1<quirksModern>,
+    &chip8::opcode_8XY2<quirksModern>, &chip8::opcode_8XY3<quirksModern>,
+    &chip8::opcode_8XY4, &chip8::opcode_8XY5,
+    &chip8::opcode_8XY6<quirksModern>, &chip8::opcode_8XY7,
+    &chip8::opcode_8XYE<quirksModern>, &chip8::opcode_9XY0<quirksModern>,
+    &chip8::opcode_ANNN, &chip8::opcode_BNNN<quirksModern>,
+    &chip8::opcode_CXNN, &chip8::opcode_DXYN<quirksModern>,
+    &chip8::opcode_EX9E<quirksModern>, &chip8::opcode_EXA1<quirksModern>,
+    &chip8::opcode_FX07, &chip8::opcode_FX0A,
+    &chip8::opcode_FX15, &chip8::opcode_FX18,
+    &chip8::opcode_FX1E, &chip8::opcode_FX29,
+    &chip8::opcode_FX33, &chip8::opcode_FX55<quirksModern>,
+    &chip8::opcode_FX65<quirksModern>,
+    &chip8::opcode_00CN, &chip8::opcode_00FB,
+    &chip8::opcode_00FC, &chip8::opcode_00FD,
+    &chip8::opcode_00FE, &chip8::opcode_00FF,
+    &chip8::opcode_FX30, &chip8::opcode_FX75,
+    &chip8::opcode_FX85, &chip8::opcode_00DN,
+    &chip8::opcode_5XY2, &chip8::opcode_5XY3,
+    &chip8::opcode_F000, &chip8::opcode_FN01,
+    &chip8::opcode_F002, &chip8::opcode_FX3A
+};
+
+chip8::chip8()
+{
+    ///< chip8 mixes public and private members, offsetof still works on it with GCC and Clang
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+    static_assert(offsetof(chip8, frameCycles) + sizeof(frameCycles) <= CACHE_LINE_SIZE,
+                  "registers and interpreter loops must fit the first cache line");
+    static_assert(offsetof(chip8, memory) <= CACHE_LINE_SIZE,
+                  "the memory header must start by the second cache line");
+#pragma GCC diagnostic pop
+    static_assert(sizeof(chip8) % CACHE_LINE_SIZE == 0 && sizeof(chip8) <= 6400,
+                  "one instance should stay within 100 cache lines");
+    fusion = true;
+    verbose = true;
+    timing = TIMING_FIXED;
+    setQuirks(QUIRKS_MODERN);
+    initialize();
+}
 
 void chip8::initialize()
 {
@@ -75,366 +234,622 @@ void chip8::initialize()
     I = 0;
     sp = 0;
     ///< Clear display, stack, registers, and memory
-    memset(gfx, 0, GFX_SIZE);
+    memset(gfx, 0, sizeof(gfx));
+    hiresMode = false;
+    memset(rplFlags, 0, RPL_SIZE);
+    planeMask = 0x1;
+    memset(audioPattern, 0, AUDIO_PATTERN_SIZE);
+    pitch = 64;
+    memset(fusionStats, 0, sizeof(fusionStats));
+    frameCycles = VIP_DISPLAY_CYCLES;
     memset(stack, 0, sizeof(unsigned short)*STACK_SIZE);
     memset(V, 0, REGISTER_SIZE);
-    memset(memory, 0, MEMORY_SIZE);
+    memory.clear();
+    memset(key, 0, KEYPAD_SIZE);
 
-    ///< Load the font set
-    for(int i = 0; i<80; ++i)
-    {
-        memory[i] = chip8_fontset[i];
-    }
+    ///< Load the font set, the rest of memory is zero so its hash is the font's
+    memcpy(&memory[0], bootFont.bytes, FONT_AREA_SIZE);
+    memHash = bootFont.hash;
+    gfxHash = 0;
 
     ///< Reset timers
     delay_timer = 60;
     sound_timer = 60;
 
-    srand (time(NULL));
+    seedRandom(time(NULL));
+}
+
+void chip8::seedRandom(unsigned int seed)
+{
+    ///< xorshift state must never be zero
+    rngState = seed ? seed : 0x9E3779B9;
+}
+
+unsigned char chip8::nextRandom()
+{
+    ///< xorshift32, cheap and private to this instance
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return (unsigned char)(rngState >> 24);
 }
 
 void chip8::clearDisp()
 {
-    memset(gfx, 0, GFX_SIZE);
+    ///< Only the selected planes are cleared
+    for(int p = 0; p < NUM_PLANES; p++)
+    {
+        if(planeMask & (1 << p))
+        {
+            memset(gfx[p], 0, sizeof(gfx[p]));
+        }
+    }
+    rehashDisplay();
 }
 
-bool chip8::loadGame(const char *romName)
+unsigned long long chip8::loresRow(int y) const
 {
-    initialize();
-    printf("Loading: %s\n", romName);
-    char buffer[4096];
-    memset(buffer, 0, 4096);
+    if(!hiresMode)
+    {
+        return gfx[0][y][0] | gfx[1][y][0];
+    }
+
+    ///< OR the two hires rows, then each pair of columns, then squeeze out the gaps
+    unsigned long long packed = 0;
+    for(int w = 0; w < GFX_ROW_WORDS; w++)
+    {
+        unsigned long long v = gfx[0][y * 2][w] | gfx[0][y * 2 + 1][w] |
+                               gfx[1][y * 2][w] | gfx[1][y * 2 + 1][w];
+        v = (v | (v >> 1)) & 0x5555555555555555ULL;
+        v = (v | (v >> 1)) & 0x3333333333333333ULL;
+        v = (v | (v >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+        v = (v | (v >> 4)) & 0x00FF00FF00FF00FFULL;
+        v = (v | (v >> 8)) & 0x0000FFFF0000FFFFULL;
+        v = (v | (v >> 16)) & 0x00000000FFFFFFFFULL;
+        packed = (packed << 32) | v;
+    }
+    return packed;
+}
+
+inline void chip8::writeMemory(unsigned int address, unsigned char value)
+{
+    address &= memory.size() - 1;
+    memHash ^= memoryTerm(address, memory[address]) ^ memoryTerm(address, value);
+    memory[address] = value;
+}
+
+void chip8::rehashDisplay()
+{
+    gfxHash = 0;
+    for(int p = 0; p < NUM_PLANES; p++)
+    {
+        for(int y = 0; y < HIRES_HEIGHT; y++)
+        {
+            for(int w = 0; w < GFX_ROW_WORDS; w++)
+            {
+                gfxHash ^= displayTerm(DISPLAY_WORD(p, y, w), gfx[p][y][w]);
+            }
+        }
+    }
+}
+
+unsigned long long chip8::registerHash() const
+{
+    unsigned long long h = mixHash(((unsigned long long)pc << 48) | ((unsigned long long)I << 32) |
+                                   ((unsigned long long)sp << 16) | (delay_timer << 8) | sound_timer);
+    h = mixHash(h ^ hiresMode ^ ((unsigned long long)planeMask << 8));
+    for(int i = 0; i < REGISTER_SIZE; i += 8)
+    {
+        unsigned long long word;
+        memcpy(&word, &V[i], sizeof(word));
+        h = mixHash(h ^ word);
+    }
+    for(int i = 0; i < STACK_SIZE; i += 4)
+    {
+        unsigned long long word;
+        memcpy(&word, &stack[i], sizeof(word));
+        h = mixHash(h ^ word);
+    }
+    ///< Everything later opcodes read: CXNN's generator, FX85 flags, audio
+    h = mixHash(h ^ rngState ^ ((unsigned long long)pitch << 32));
+    for(int i = 0; i < RPL_SIZE; i += 8)
+    {
+        unsigned long long word;
+        memcpy(&word, &rplFlags[i], sizeof(word));
+        h = mixHash(h ^ word);
+    }
+    for(int i = 0; i < AUDIO_PATTERN_SIZE; i += 8)
+    {
+        unsigned long long word;
+        memcpy(&word, &audioPattern[i], sizeof(word));
+        h = mixHash(h ^ word);
+    }
+    return h;
+}
+
+unsigned long long chip8::stateHash() const
+{
+    return registerHash() ^ memHash ^ gfxHash;
+}
+
+unsigned long long chip8::computeStateHash() const
+{
+    unsigned long long h = registerHash();
+    for(unsigned int i = 0; i < memory.size(); i++)
+    {
+        h ^= memoryTerm(i, memory[i]);
+    }
+    for(int p = 0; p < NUM_PLANES; p++)
+    {
+        for(int y = 0; y < HIRES_HEIGHT; y++)
+        {
+            for(int w = 0; w < GFX_ROW_WORDS; w++)
+            {
+                h ^= displayTerm(DISPLAY_WORD(p, y, w), gfx[p][y][w]);
+            }
+        }
+    }
+    return h;
+}
 
+bool chip8::loadGame(const char *romName, QUIRKS_t quirks)
+{
+    printf("Loading: %s\n", romName);
 
-    FILE *fptr;
-    fptr = fopen(romName, "rb");
 
-    if(fptr == NULL)
+    ///< The file is mapped, the only copy is the one into memory
+    romFile file;
+    if(!file.open(romName))
     {
         fputs("File Error", stderr);
         return false;
     }
+    printf("Filesize: %d\n", (int)file.size());
 
-    ///< Check the file size
-    fseek(fptr, 0, SEEK_END);
-    long fileSize = ftell(fptr);
-    printf("Filesize: %d\n", (int)fileSize);
-
-    fseek(fptr, 0, SEEK_SET);
-    size_t bytesRead = fread(buffer, 1, fileSize, fptr);
-    if (bytesRead != (size_t)fileSize)
+    if(!loadRom(file.data(), file.size(), quirks))
     {
-        fputs("reading error", stderr);
+        fputs("ROM too large", stderr);
         return false;
     }
+    return true;
+}
 
-    ///< copy buffer to memory
-    for(int i = 0; i<fileSize; i++)
+bool chip8::loadRom(const unsigned char *data, size_t size, QUIRKS_t quirks)
+{
+    if(size > ((quirks == QUIRKS_XOCHIP) ? XO_MAX_ROM_SIZE : MAX_ROM_SIZE))
     {
-        memory[0x200 + i] = buffer[i];
+        return false;
     }
 
-    fclose(fptr);
+    ///< Select the profile first, it decides the memory size
+    setQuirks(quirks);
+    initialize();
+
+    ///< copy rom to memory
+    if(size > 0)
+    {
+        memcpy(&memory[ROM_START], data, size);
+        ///< Only the ROM bytes are new, no need to rehash the whole address space
+        for(size_t i = 0; i < size; i++)
+        {
+            memHash ^= memoryTerm(ROM_START + i, data[i]);
+        }
+    }
     return true;
 }
 
 void chip8::emulateCycle()
 {
-    ///< Fetch Opcode
-    opcode = fetchOpcode();
+    if(timing == TIMING_VIP)
+    {
+        ///< Timers only tick once a frame worth of machine cycles has gone by
+        executeVip(*this, 1);
+        if(!nextVipFrame())
+        {
+            return;
+        }
+    }
+    else
+    {
+        execute(*this, 1);
+    }
 
-    ///< Decode Opcode
-    opcodeMap(opcode);
-    
     ///< Update Timers
-    if(delay_timer > 0)
+    if(updateTimers() && verbose)
     {
-        delay_timer--;
+        printf("BEEP!!\n");
     }
-    if(sound_timer > 0){
-        if(sound_timer == 1)
-        {
-            printf("BEEP!!\n");
-        }
-        --sound_timer;
+}
+
+void chip8::emulateFrame(int cycles)
+{
+    ///< Run one 60Hz frame worth of instructions, then tick the timers once
+    if(timing == TIMING_VIP)
+    {
+        ///< The frame length comes from the cycle table, cycles is not used
+        executeVip(*this, INT_MAX);
+        nextVipFrame();
     }
+    else
+    {
+        executeFrame(*this, cycles);
+    }
+    updateTimers();
 }
 
-unsigned short chip8::fetchOpcode()
+bool chip8::nextVipFrame()
 {
-    return ((memory[pc] << 8) | (memory[pc + 1]));
+    if(frameCycles < VIP_CYCLES_PER_FRAME)
+    {
+        return false;
+    }
+    ///< Carry the overshoot, the next frame starts after the display DMA
+    frameCycles -= VIP_CYCLES_PER_FRAME - VIP_DISPLAY_CYCLES;
+    return true;
 }
 
-int chip8::opcodeMap(unsigned short opcode)
+template <class Q>
+void chip8::executeTimed(int cycles)
 {
-        switch(opcode & 0xF000)
+    while(cycles > 0 && frameCycles < VIP_CYCLES_PER_FRAME)
     {
-        case 0x0000:
-        {
-            switch(opcode & 0x000F)
-            {
-                case 0x0000: ///< opcode 0x00E0
-                    opcode_00E0();
-                    return OPCODE_00E0;
-                break;
-                //////////////////////////////////////////////////////
-                case 0x000E: ///< opcode 0x00EE
-                    opcode_00EE();
-                    return OPCODE_00EE;
-                break;
-                //////////////////////////////////////////////////////
-                default:
-                    printf("unkown opcode 0x%X\n", opcode);
-                    return -1;
+        opcode = fetchOpcode();
+        int op = opcodeMap<Q>(opcode);
+        frameCycles += vipCycles[op + 1];
+        cycles--;
 
-            }
-        }
-        break;
-        //////////////////////////////////////////////////////////////
-        case 0x1000: ///< opcode 0x1NNN
-        {
-            opcode_1NNN();
-            return OPCODE_1NNN;  
-        }
-        break;
-        //////////////////////////////////////////////////////////////
-        case 0x2000: ///< opcode 0x2NNN
-        {
-            opcode_2NNN();
-            return OPCODE_2NNN;
-        }
-        break;
-        //////////////////////////////////////////////////////////////
-        case 0x3000: ///< opcode 0x3XNN
-        {
-            opcode_3XNN();
-            return OPCODE_3XNN;
-        }
-        break;
-        //////////////////////////////////////////////////////////////
-        case 0x4000: ///< opcode 0x4XNN
-        {
-            opcode_4XNN();
-            return OPCODE_4XNN;
-        }
-        break;
-        //////////////////////////////////////////////////////////////
-        case 0x5000: ///< opcode 0x5XY0
-        {
-            opcode_5XY0();
-            return OPCODE_5XY0;
-        }
-        break;
-        //////////////////////////////////////////////////////////////
-        case 0x6000: ///< opcode 0x6XNN
+        ///< DXYN waits for the vertical blank interrupt, which ends the frame
+        if(op == OPCODE_DXYN)
         {
-            opcode_6XNN();
-            return OPCODE_6XNN;
+            frameCycles = VIP_CYCLES_PER_FRAME;
         }
-        break;
-        //////////////////////////////////////////////////////////////
-        case 0x7000: ///< opcode 0x7XNN
+    }
+}
+
+///< Top nibbles that can start a fused sequence: 3, 4, 6, A and F
+#define FUSION_HEADS    ((1 << 0x3) | (1 << 0x4) | (1 << 0x6) | (1 << 0xA) | (1 << 0xF))
+
+template <class Q, bool FUSE>
+void chip8::executeCycles(int cycles)
+{
+    while(cycles > 0)
+    {
+        ///< Fetch Opcode
+        opcode = fetchOpcode();
+
+        ///< Fused sequences count as every instruction they replace
+        if(FUSE && cycles > 1 && ((FUSION_HEADS >> (opcode >> 12)) & 1))
         {
-            opcode_7XNN();
-            return OPCODE_7XNN;
+            int used = executeFused<Q>(cycles);
+            if(used > 0)
+            {
+                cycles -= used;
+                continue;
+            }
         }
-        break;
-        //////////////////////////////////////////////////////////////
-        case 0x8000:
-            switch (opcode & 0x000F)
+
+        ///< Decode Opcode
+        opcodeMap<Q>(opcode);
+        cycles--;
+    }
+}
+
+template <class Q>
+int chip8::executeFused(int remaining)
+{
+    unsigned short next = (memory[pc + 2] << 8) | memory[pc + 3];
+
+    switch(opcode & 0xF000)
+    {
+        case 0x3000: ///< 3XNN/4XNN guarding a jump
+        case 0x4000:
+            if((next & 0xF000) == 0x1000)
             {
-                case 0x0000: ///< opcode 0x8XY0
-                {
-                    opcode_8XY0();
-                    return OPCODE_8XY0;
-                }
-                break;
-                case 0x0001: ///< opcode 0x8XY1
-                {
-                    opcode_8XY1();
-                    return OPCODE_8XY1;
-                }
-                break;
-                case 0x0002: ///< opcode 0x8XY2
-                {
-                    opcode_8XY2();
-                    return OPCODE_8XY2;
-                }
-                break;
-                case 0x0003: ///< opcode 0x8XY3
-                {
-                    opcode_8XY3();
-                    return OPCODE_8XY3;
-                }
-                break;
-                case 0x0004: ///< opcode 0x8XY4
+                bool equal = V[X_VAL] == (opcode & 0x00FF);
+                fusionStats[FUSE_SKIP_JUMP]++;
+                if(equal == ((opcode & 0xF000) == 0x3000))
                 {
-                    opcode_8XY4();
-                    return OPCODE_8XY4;
+                    ///< Skipped, the jump never runs
+                    pc += 4;
+                    return 1;
                 }
-                break;
-                case 0x0005: ///< opcode 0x8XY5
-                {
-                    opcode_8XY5();
-                    return OPCODE_8XY5;
-                }
-                break;
-                case 0x0006: ///< opcode 0x8XY6
+                pc = next & 0x0FFF;
+                return 2;
+            }
+        break;
+        case 0x6000: ///< Run of 6XNN loads
+            if((next & 0xF000) == 0x6000)
+            {
+                int used = 0;
+                while(used < remaining && (opcode & 0xF000) == 0x6000)
                 {
-                    opcode_8XY6();
-                    return OPCODE_8XY6;
+                    V[X_VAL] = opcode & 0x00FF;
+                    pc += 2;
+                    used++;
+                    opcode = fetchOpcode();
                 }
-                break;
-                case 0x0007: ///< opcode 0x8XY7
+                fusionStats[FUSE_LOAD_RUN]++;
+                return used;
+            }
+        break;
+        case 0xA000: ///< ANNN setting up a DXYN
+            if((next & 0xF000) == 0xD000)
+            {
+                I = opcode & 0x0FFF;
+                pc += 2;
+                opcode = next;
+                opcode_DXYN<Q>();
+                fusionStats[FUSE_INDEX_DRAW]++;
+                return 2;
+            }
+        break;
+        case 0xF000: ///< FX07, 3X00, 1NNN polling the delay timer
+            if((opcode & 0x00FF) == 0x0007 && next == (0x3000 | (opcode & 0x0F00)) &&
+               ((memory[pc + 4] << 8) | memory[pc + 5]) == (0x1000 | pc))
+            {
+                V[X_VAL] = delay_timer;
+                if(delay_timer == 0)
                 {
-                    opcode_8XY7();
-                    return OPCODE_8XY7;
+                    ///< Timer already ran out, FX07 then 3X00 skips the jump
+                    pc += 6;
+                    fusionStats[FUSE_DELAY_WAIT]++;
+                    return 2;
                 }
-                break;
-                case 0x000E: ///< opcode 0x8XYE
+                ///< The timer only ticks between frames, so every loop until then is the same
+                int loops = remaining / 3;
+                if(loops > 0)
                 {
-                    opcode_8XYE();
-                    return OPCODE_8XYE;
+                    fusionStats[FUSE_DELAY_WAIT]++;
+                    return loops * 3;
                 }
-                break;
-
-                default:
-                    printf("Unknown opcode [0x8000]: 0x%X\n", opcode);
-                    return -1;
             }
+        break;
+    }
+
+    return 0;
+}
+
+const char *chip8::fusionName(FUSION_t fusion)
+{
+    static const char *names[NUM_FUSIONS] = {
+        "skip+jump", "load run", "index+draw", "delay wait"
+    };
+    return (fusion < NUM_FUSIONS) ? names[fusion] : "unknown";
+}
+
+void chip8::setFusion(bool enable)
+{
+    fusion = enable;
+    setQuirks(quirks);
+}
+
+template <class Q>
+void chip8::selectLoops()
+{
+    execute = &chip8::runCycles<Q, false>;
+    executeVip = &chip8::runTimed<Q>;
+    executeFrame = fusion ? &chip8::runCycles<Q, true> : &chip8::runCycles<Q, false>;
+}
 
+void chip8::setQuirks(QUIRKS_t profile)
+{
+    switch(profile)
+    {
+        case QUIRKS_VIP:
+            selectLoops<quirksVip>();
         break;
-        //////////////////////////////////////////////////////////////
-        case 0x9000: ///< opcode 9XY0
-        {
-            opcode_9XY0();
-            return OPCODE_9XY0;
-        }
+        case QUIRKS_CHIP48:
+            selectLoops<quirksChip48>();
         break;
-        //////////////////////////////////////////////////////////////
-        case 0xA000: ///< opcode ANNN
-        {
-            opcode_ANNN();
-            return OPCODE_ANNN;
-        }
+        case QUIRKS_SCHIP:
+            selectLoops<quirksSchip>();
         break;
-        //////////////////////////////////////////////////////////////
-        case 0xB000: ///< opcode 0xBNNN
-        {
-            opcode_BNNN();
-            return OPCODE_BNNN;
-        }
+        case QUIRKS_XOCHIP:
+            selectLoops<quirksXoChip>();
         break;
-        //////////////////////////////////////////////////////////////
-        case 0xC000: ///< opcode 0xCXNN
+        default:
+            profile = QUIRKS_MODERN;
+            selectLoops<quirksModern>();
+    }
+    quirks = profile;
+    memory.setExtended(profile == QUIRKS_XOCHIP);
+}
+
+bool chip8::updateTimers()
+{
+    bool beep = false;
+
+    if(delay_timer > 0)
+    {
+        delay_timer--;
+    }
+    if(sound_timer > 0){
+        if(sound_timer == 1)
         {
-            opcode_CXNN();
-            return OPCODE_CXNN;
+            beep = true;
         }
-        break;
-        //////////////////////////////////////////////////////////////
-        case 0xD000: ///< opcode DXYN (Graphics)
+        --sound_timer;
+    }
+    return beep;
+}
+
+bool chip8::waitingForKey() const
+{
+    unsigned short next = (memory[pc] << 8) | memory[pc + 1];
+    if((next & 0xF0FF) != 0xF00A || delay_timer != 0 || sound_timer != 0)
+    {
+        return false;
+    }
+    for(int k = 0; k < KEYPAD_SIZE; k++)
+    {
+        if(key[k] != 0)
         {
-            opcode_DXYN();
-            return OPCODE_DXYN;
+            return false;
         }
-        break;
-        //////////////////////////////////////////////////////////////
+    }
+    return true;
+}
+
+unsigned short chip8::fetchOpcode()
+{
+    return ((memory[pc] << 8) | (memory[pc + 1]));
+}
+
+static_assert(OPCODE_FX3A + 1 == NUM_OPCODES, "OPCODE_t and NUM_OPCODES disagree");
+
+template <class Q>
+inline int chip8::decodeOpcode(unsigned short opcode)
+{
+    switch(opcode & 0xF000)
+    {
+        case 0x0000:
+            switch(opcode & 0x00FF)
+            {
+                case 0x00E0: return OPCODE_00E0;
+                case 0x00EE: return OPCODE_00EE;
+                case 0x00FB: return Q::superChip ? OPCODE_00FB : -1;   ///< scroll right
+                case 0x00FC: return Q::superChip ? OPCODE_00FC : -1;   ///< scroll left
+                case 0x00FD: return Q::superChip ? OPCODE_00FD : -1;   ///< exit
+                case 0x00FE: return Q::superChip ? OPCODE_00FE : -1;   ///< lores
+                case 0x00FF: return Q::superChip ? OPCODE_00FF : -1;   ///< hires
+            }
+            if(Q::superChip && (opcode & 0x0FF0) == 0x00C0) return OPCODE_00CN;  ///< scroll down
+            if(Q::xoChip && (opcode & 0x0FF0) == 0x00D0) return OPCODE_00DN;     ///< scroll up
+            return -1;
+        case 0x1000: return OPCODE_1NNN;
+        case 0x2000: return OPCODE_2NNN;
+        case 0x3000: return OPCODE_3XNN;
+        case 0x4000: return OPCODE_4XNN;
+        case 0x5000:
+            if(Q::xoChip && (opcode & 0x000F) == 0x0002) return OPCODE_5XY2;    ///< save VX..VY
+            if(Q::xoChip && (opcode & 0x000F) == 0x0003) return OPCODE_5XY3;    ///< load VX..VY
+            return OPCODE_5XY0;
+        case 0x6000: return OPCODE_6XNN;
+        case 0x7000: return OPCODE_7XNN;
+        case 0x8000:
+            switch(opcode & 0x000F)
+            {
+                case 0x0000: return OPCODE_8XY0;
+                case 0x0001: return OPCODE_8XY1;
+                case 0x0002: return OPCODE_8XY2;
+                case 0x0003: return OPCODE_8XY3;
+                case 0x0004: return OPCODE_8XY4;
+                case 0x0005: return OPCODE_8XY5;
+                case 0x0006: return OPCODE_8XY6;
+                case 0x0007: return OPCODE_8XY7;
+                case 0x000E: return OPCODE_8XYE;
+            }
+            return -1;
+        case 0x9000: return OPCODE_9XY0;
+        case 0xA000: return OPCODE_ANNN;
+        case 0xB000: return OPCODE_BNNN;
+        case 0xC000: return OPCODE_CXNN;
+        case 0xD000: return OPCODE_DXYN;
         case 0xE000:
-        {
-            switch (opcode & 0x00FF)
+            switch(opcode & 0x00FF)
             {
-                case 0x009E: ///< opcode 0xEX9E
-                {
-                    opcode_EX9E();
-                    return OPCODE_EX9E;
-                }
-                break;
-                //////////////////////////////////////////////////////////////
-                case 0x00A1: ///< opcode 0xEXA1
-                {
-                    opcode_EXA1();
-                    return OPCODE_EXA1;
-                }
-                break;
-                //////////////////////////////////////////////////////////////
-                default:
-                    printf("Unknown opcode [0xE000]: 0x%X\n", opcode);
-                    return -1;
+                case 0x009E: return OPCODE_EX9E;
+                case 0x00A1: return OPCODE_EXA1;
             }
-        }
-        break;
-        //////////////////////////////////////////////////////////////
-
-        //////////////////////////////////////////////////////////////
-        case 0xF000:
-            switch (opcode & 0x00FF)
+            return -1;
+        default:
+            switch(opcode & 0x00FF)
             {
-                case 0x0007: ///< opcode 0xFX07
-                {
-                    opcode_FX07();
-                    return OPCODE_FX07;
-                }
-                break;
-                case 0x000A: ///< opcode 0xFX0A (key operation)
-                {
-                    opcode_FX0A();
-                    return OPCODE_FX0A;
-                }
-                case 0x0015: ///< opcode 0xFX15
-                {
-                    opcode_FX15();
-                    return OPCODE_FX15;
-                }
-                break;
-                case 0x0018: ///< opcode 0xFX18
-                {
-                    opcode_FX18();
-                    return OPCODE_FX18;
-                }
-                break;
-                case 0x001E: ///< opcode 0xFX1E
-                {
-                    opcode_FX1E();
-                    return OPCODE_FX1E;
-                }
-                break;
-                case 0x0029: ///< opcode 0xFX29
-                {
-                    opcode_FX29();
-                    return OPCODE_FX29;
-                }
-                break;
-                case 0x0033: ///< opcode 0xFX33
-                {
-                    opcode_FX33();
-                    return OPCODE_FX33;
-                }
-                break;
-                case 0x0055: ///< opcode 0xFX55
-                {
-                    opcode_FX55();
-                    return OPCODE_FX55;
-                }
-                break;
-                case 0x0065: ///< opcode 0xFX65
-                {
-                    opcode_FX65();
-                    return OPCODE_FX65;
-                }
-                break;
+                case 0x0000: return (Q::xoChip && opcode == 0xF000) ? OPCODE_F000 : -1;  ///< long load
+                case 0x0001: return Q::xoChip ? OPCODE_FN01 : -1;                         ///< plane select
+                case 0x0002: return (Q::xoChip && opcode == 0xF002) ? OPCODE_F002 : -1;  ///< audio pattern
+                case 0x003A: return Q::xoChip ? OPCODE_FX3A : -1;                         ///< pitch
+                case 0x0007: return OPCODE_FX07;
+                case 0x000A: return OPCODE_FX0A;
+                case 0x0015: return OPCODE_FX15;
+                case 0x0018: return OPCODE_FX18;
+                case 0x001E: return OPCODE_FX1E;
+                case 0x0029: return OPCODE_FX29;
+                case 0x0033: return OPCODE_FX33;
+                case 0x0055: return OPCODE_FX55;
+                case 0x0065: return OPCODE_FX65;
+                case 0x0030: return Q::superChip ? OPCODE_FX30 : -1;                      ///< big font
+                case 0x0075: return Q::superChip ? OPCODE_FX75 : -1;                      ///< save RPL flags
+                case 0x0085: return Q::superChip ? OPCODE_FX85 : -1;                      ///< load RPL flags
+            }
+            return -1;
+    }
+}
+
+int chip8::decodeOpcode(unsigned short opcode, QUIRKS_t profile)
+{
+    switch(profile)
+    {
+        case QUIRKS_VIP:    return decodeOpcode<quirksVip>(opcode);
+        case QUIRKS_CHIP48: return decodeOpcode<quirksChip48>(opcode);
+        case QUIRKS_SCHIP:  return decodeOpcode<quirksSchip>(opcode);
+        case QUIRKS_XOCHIP: return decodeOpcode<quirksXoChip>(opcode);
+        default:            return decodeOpcode<quirksModern>(opcode);
+    }
+}
 
-                default:
-                    printf("Unknown opcode [0xF000]: 0x%X\n", opcode);
-            }
-        break;
-        /////////////////////////////////////////////////////////////
+template <class Q>
+int chip8::opcodeMap(unsigned short opcode)
+{
+    ///< Decoding is shared with tools that look at opcodes without running them
+    int op = decodeOpcode<Q>(opcode);
+
+    switch(op)
+    {
+        case OPCODE_00E0: opcode_00E0(); break;
+        case OPCODE_00EE: opcode_00EE(); break;
+        case OPCODE_1NNN: opcode_1NNN(); break;
+        case OPCODE_2NNN: opcode_2NNN(); break;
+        case OPCODE_3XNN: opcode_3XNN<Q>(); break;
+        case OPCODE_4XNN: opcode_4XNN<Q>(); break;
+        case OPCODE_5XY0: opcode_5XY0<Q>(); break;
+        case OPCODE_6XNN: opcode_6XNN(); break;
+        case OPCODE_7XNN: opcode_7XNN(); break;
+        case OPCODE_8XY0: opcode_8XY0(); break;
+        case OPCODE_8XY1: opcode_8XY1<Q>(); break;
+        case OPCODE_8XY2: opcode_8XY2<Q>(); break;
+        case OPCODE_8XY3: opcode_8XY3<Q>(); break;
+        case OPCODE_8XY4: opcode_8XY4(); break;
+        case OPCODE_8XY5: opcode_8XY5(); break;
+        case OPCODE_8XY6: opcode_8XY6<Q>(); break;
+        case OPCODE_8XY7: opcode_8XY7(); break;
+        case OPCODE_8XYE: opcode_8XYE<Q>(); break;
+        case OPCODE_9XY0: opcode_9XY0<Q>(); break;
+        case OPCODE_ANNN: opcode_ANNN(); break;
+        case OPCODE_BNNN: opcode_BNNN<Q>(); break;
+        case OPCODE_CXNN: opcode_CXNN(); break;
+        case OPCODE_DXYN: opcode_DXYN<Q>(); break;
+        case OPCODE_EX9E: opcode_EX9E<Q>(); break;
+        case OPCODE_EXA1: opcode_EXA1<Q>(); break;
+        case OPCODE_FX07: opcode_FX07(); break;
+        case OPCODE_FX0A: opcode_FX0A(); break;
+        case OPCODE_FX15: opcode_FX15(); break;
+        case OPCODE_FX18: opcode_FX18(); break;
+        case OPCODE_FX1E: opcode_FX1E(); break;
+        case OPCODE_FX29: opcode_FX29(); break;
+        case OPCODE_FX33: opcode_FX33(); break;
+        case OPCODE_FX55: opcode_FX55<Q>(); break;
+        case OPCODE_FX65: opcode_FX65<Q>(); break;
+        case OPCODE_00CN: opcode_00CN(); break;
+        case OPCODE_00FB: opcode_00FB(); break;
+        case OPCODE_00FC: opcode_00FC(); break;
+        case OPCODE_00FD: opcode_00FD(); break;
+        case OPCODE_00FE: opcode_00FE(); break;
+        case OPCODE_00FF: opcode_00FF(); break;
+        case OPCODE_FX30: opcode_FX30(); break;
+        case OPCODE_FX75: opcode_FX75(); break;
+        case OPCODE_FX85: opcode_FX85(); break;
+        case OPCODE_00DN: opcode_00DN(); break;
+        case OPCODE_5XY2: opcode_5XY2(); break;
+        case OPCODE_5XY3: opcode_5XY3(); break;
+        case OPCODE_F000: opcode_F000(); break;
+        case OPCODE_FN01: opcode_FN01(); break;
+        case OPCODE_F002: opcode_F002(); break;
+        case OPCODE_FX3A: opcode_FX3A(); break;
         default:
-            printf("Unkown Opcode: 0x%X\n", opcode);
-            return -1;
+            LOG_UNKNOWN("Unknown opcode: 0x%X\n", opcode);
     }
-
-    return -1;
+    return op;
 }
 
 
@@ -456,7 +871,8 @@ void chip8::opcode_00E0()
 
 void chip8::opcode_00EE()
 {
-    --sp;
+    ///< The stack pointer wraps instead of running off either end of the stack
+    sp = (sp - 1) & (STACK_SIZE - 1);
     pc = stack[sp];
     pc += 2;
 }
@@ -468,40 +884,57 @@ void chip8::opcode_1NNN()
 
 void chip8::opcode_2NNN()
 {
-    stack[sp] = pc;         ///< Save the PC in the stack
-    ++sp;                   ///< Increment the stack pointer
+    stack[sp] = pc;                     ///< Save the PC in the stack
+    sp = (sp + 1) & (STACK_SIZE - 1);   ///< Increment the stack pointer, wrapping
     pc = opcode & 0x0FFF;   ///< Jump to NNN
 }
+template <class Q>
+void chip8::skipNext()
+{
+    ///< The XO-CHIP long load F000 NNNN is 4 bytes, skipping it skips both words
+    if(Q::xoChip && memory[pc + 2] == 0xF0 && memory[pc + 3] == 0x00)
+    {
+        pc += 6;
+    }
+    else
+    {
+        pc += 4;
+    }
+}
+
+template <class Q>
 void chip8::opcode_3XNN()
 {
     ///< if Vx = NN, skip next instruction
     if(V[(opcode & 0x0F00) >> 8] == (opcode & 0x00FF))
     {
-        pc += 4;
+        skipNext<Q>();
     }
     else
     {
         pc += 2;
     }
 }
+template <class Q>
 void chip8::opcode_4XNN()
 {
     ///< if Vx != NN, skip next instruction
     if(V[(opcode & 0x0F00) >> 8] != (opcode & 0x00FF))
     {
-        pc += 4;
+        skipNext<Q>();
     }
     else
     {
         pc += 2;
     }
 }
+template <class Q>
 void chip8::opcode_5XY0()
 {
     ///< if Vx = Vy, skip next instruction
     if(V[(opcode & 0x0F00) >> 8] == V[(opcode & 0x00F0) >> 4])
     {
-        pc += 4;
+        skipNext<Q>();
     }
     else
     {
@@ -527,22 +960,37 @@ void chip8::opcode_8XY0()
     V[(opcode & 0x0F00) >> 8] = V[(opcode & 0x00F0) >> 4];
     pc += 2;
 }
+template <class Q>
 void chip8::opcode_8XY1()
 {
     ///< Vx = Vx|Vy
     V[(opcode & 0x0F00) >> 8] = V[(opcode & 0x0F00) >> 8] | V[(opcode & 0x00F0) >> 4];
+    if(Q::logicResetsVF)
+    {
+        V[0xF] = 0;
+    }
     pc += 2;
 }
+template <class Q>
 void chip8::opcode_8XY2()
 {
     ///< Vx = Vx&Vy
     V[(opcode & 0x0F00) >> 8] = V[(opcode & 0x0F00) >> 8] & V[(opcode & 0x00F0) >> 4];
+    if(Q::logicResetsVF)
+    {
+        V[0xF] = 0;
+    }
     pc += 2;
 }
+template <class Q>
 void chip8::opcode_8XY3()
 {
     ///< Vx = Vx^Vy
     V[(opcode & 0x0F00) >> 8] = V[(opcode & 0x0F00) >> 8] ^ V[(opcode & 0x00F0) >> 4];
+    if(Q::logicResetsVF)
+    {
+        V[0xF] = 0;
+    }
     pc += 2;
 }
 void chip8::opcode_8XY4()
@@ -573,11 +1021,22 @@ void chip8::opcode_8XY5()
     pc += 2;
 
 }
+template <class Q>
 void chip8::opcode_8XY6()
 {
-    ///< Vx >>= 1
-    V[0xF] = V[(opcode & 0x0F00) >> 8] & 0x1;
-    V[(opcode & 0x0F00) >> 8] >>= 1;
+    if(Q::shiftUsesVY)
+    {
+        ///< Vx = Vy >> 1
+        unsigned char vy = V[Y_VAL];
+        V[X_VAL] = vy >> 1;
+        V[0xF] = vy & 0x1;
+    }
+    else
+    {
+        ///< Vx >>= 1
+        V[0xF] = V[(opcode & 0x0F00) >> 8] & 0x1;
+        V[(opcode & 0x0F00) >> 8] >>= 1;
+    }
     pc += 2;
 }
 void chip8::opcode_8XY7()
@@ -594,19 +1053,31 @@ void chip8::opcode_8XY7()
     V[(opcode & 0x0F00) >> 8] = V[(opcode & 0x00F0) >> 4] - V[(opcode & 0x0F00) >> 8];
     pc += 2;
 }
+template <class Q>
 void chip8::opcode_8XYE()
 {
-    ///< Vx <<= 1
-    V[0xF] = V[(opcode & 0x0F00) >> 8] >> 7;
-    V[(opcode & 0x0F00) >> 8] <<= 1;
+    if(Q::shiftUsesVY)
+    {
+        ///< Vx = Vy << 1
+        unsigned char vy = V[Y_VAL];
+        V[X_VAL] = vy << 1;
+        V[0xF] = vy >> 7;
+    }
+    else
+    {
+        ///< Vx <<= 1
+        V[0xF] = V[(opcode & 0x0F00) >> 8] >> 7;
+        V[(opcode & 0x0F00) >> 8] <<= 1;
+    }
     pc += 2;
 }
+template <class Q>
 void chip8::opcode_9XY0()
 {
     ///< Skip instruction if Vx != Vy
     if(V[X_VAL] != V[Y_VAL])
     {
-        pc += 4;
+        skipNext<Q>();
     }
     else
     {
@@ -619,59 +1090,139 @@ void chip8::opcode_ANNN()
     I = opcode & 0x0FFF;
     pc += 2;
 }
+template <class Q>
 void chip8::opcode_BNNN()
 {
-    ///< Jump tp V[0] + NNN
-    pc = V[0] + (opcode & 0x0FFF);
+    ///< Jump to V[0] + NNN, or V[X] + XNN
+    pc = V[Q::jumpUsesVX ? X_VAL : 0] + (opcode & 0x0FFF);
 }
 void chip8::opcode_CXNN()
 {
-    V[X_VAL] = (rand() % 0xFF) & (opcode & 0x00FF);
+    V[X_VAL] = nextRandom() & (opcode & 0x00FF);
     pc += 2;
 }
+template <class Q>
+void chip8::drawSpriteRow(int plane, int row, unsigned int bits, int width, int x)
+{
+    ///< Line the sprite up against a whole display row, MSB first
+    unsigned long long sprite = (unsigned long long)bits << (64 - width);
+    unsigned long long line[GFX_ROW_WORDS] = {0};
+    int screenWidth = displayWidth();
+
+    if(x < 64)
+    {
+        line[0] = sprite >> x;
+        if(x > 0)
+        {
+            line[1] = sprite << (64 - x);
+        }
+    }
+    else
+    {
+        line[1] = sprite >> (x - 64);
+    }
+
+    if(screenWidth == GFX_WIDTH)
+    {
+        ///< Lores rows only have word 0, bits spilling into word 1 are past the edge
+        if(!Q::clipSprites && x + width > GFX_WIDTH)
+        {
+            line[0] |= sprite << (GFX_WIDTH - x);
+        }
+        line[1] = 0;
+    }
+    else if(!Q::clipSprites && x + width > HIRES_WIDTH)
+    {
+        line[0] |= sprite << (HIRES_WIDTH - x);
+    }
+
+    for(int w = 0; w < GFX_ROW_WORDS; w++)
+    {
+        if(line[w] == 0)
+        {
+            continue;
+        }
+        unsigned long long old = gfx[plane][row][w];
+        if(old & line[w])
+        {
+            V[0xF] = 1;
+        }
+        gfx[plane][row][w] = old ^ line[w];
+        gfxHash ^= displayTerm(DISPLAY_WORD(plane, row, w), old) ^
+                   displayTerm(DISPLAY_WORD(plane, row, w), gfx[plane][row][w]);
+    }
+}
+
+template <class Q>
 void chip8::opcode_DXYN()
 {
-    unsigned short x = V[(opcode & 0x0F00) >> 8];
-    unsigned short y = V[(opcode & 0x00F0) >> 4];
+    ///< The start position always wraps, the sprite then clips or wraps per profile
+    int screenWidth = displayWidth();
+    int screenHeight = displayHeight();
+    unsigned short x = V[(opcode & 0x0F00) >> 8] & (screenWidth - 1);
+    unsigned short y = V[(opcode & 0x00F0) >> 4] & (screenHeight - 1);
     unsigned short height = (opcode & 0x000F);
-    unsigned short pixel;
 
     V[0xF] = 0;
-    for (int yline = 0; yline < height; yline++)
+
+    ///< XO-CHIP draws each selected plane in turn, the data for plane 2 follows plane 1
+    unsigned short address = I;
+    for(int plane = 0; plane < NUM_PLANES; plane++)
     {
-        pixel = memory[I + yline];
-        for (int xline = 0; xline < 8; xline++)
+        if(!(planeMask & (1 << plane)))
+        {
+            continue;
+        }
+
+        if(Q::superChip && height == 0)
+        {
+            ///< DXY0 draws a 16x16 sprite from 32 bytes at I
+            for (int yline = 0; yline < 16; yline++)
+            {
+                if(Q::clipSprites && y + yline >= screenHeight)
+                {
+                    break;
+                }
+                unsigned int bits = (memory[address + yline * 2] << 8) | memory[address + yline * 2 + 1];
+                drawSpriteRow<Q>(plane, (y + yline) & (screenHeight - 1), bits, 16, x);
+            }
+            address += 32;
+        }
+        else
         {
-            if((pixel & (0x80 >> xline)) != 0)
+            for (int yline = 0; yline < height; yline++)
             {
-                if(gfx[(x + xline + ((y + yline)*64))] == 1)
+                if(Q::clipSprites && y + yline >= screenHeight)
                 {
-                    V[0xF] = 1;
+                    break;
                 }
-                gfx[(x + xline + ((y + yline)*64))] ^= 1;
+                drawSpriteRow<Q>(plane, (y + yline) & (screenHeight - 1), memory[address + yline], 8, x);
             }
+            address += height;
         }
     }
 
     drawFlag = true;
     pc += 2;
 }
+template <class Q>
 void chip8::opcode_EX9E()
 {
-    if(key[V[(opcode & 0x0F00) >> 8]] != 0)
+    if(key[V[(opcode & 0x0F00) >> 8] & 0xF] != 0)
     {
-        pc += 4;
+        skipNext<Q>();
     }
     else
     { 
         pc += 2;
     }
 }
+template <class Q>
 void chip8::opcode_EXA1()
 {
-    if(key[V[(opcode & 0x0F00) >> 8]] == 0)
+    if(key[V[(opcode & 0x0F00) >> 8] & 0xF] == 0)
     {
-        pc += 4;
+        skipNext<Q>();
     }
     else
     { 
@@ -728,26 +1279,373 @@ void chip8::opcode_FX29()
 }
 void chip8::opcode_FX33()
 {
-    memory[I] = V[(opcode & 0x0F00) >> 8] / 100;
-    memory[I+1] = (V[(opcode & 0x0F00) >> 8] / 10) % 10;
-    memory[I+2] = (V[(opcode & 0x0F00) >> 8]  % 100) % 10;
+    writeMemory(I, V[(opcode & 0x0F00) >> 8] / 100);
+    writeMemory(I+1, (V[(opcode & 0x0F00) >> 8] / 10) % 10);
+    writeMemory(I+2, (V[(opcode & 0x0F00) >> 8]  % 100) % 10);
     pc += 2;
 }
+template <class Q>
 void chip8::opcode_FX55()
 {
     for(int i = 0; i <= X_VAL; i++)
     {
-        memory[I + i] = V[i];
+        writeMemory(I + i, V[i]);
+    }
+    if(Q::loadStore == LOADSTORE_ADD_X1)
+    {
+        I += X_VAL + 1;
+    }
+    else if(Q::loadStore == LOADSTORE_ADD_X)
+    {
+        I += X_VAL;
     }
-    I += X_VAL + 1;
     pc += 2;
 }
+template <class Q>
 void chip8::opcode_FX65()
 {
     for(int i = 0; i <= X_VAL; i++)
     {
         V[i] = memory[I + i];
     }
-    I += X_VAL + 1;
+    if(Q::loadStore == LOADSTORE_ADD_X1)
+    {
+        I += X_VAL + 1;
+    }
+    else if(Q::loadStore == LOADSTORE_ADD_X)
+    {
+        I += X_VAL;
+    }
+    pc += 2;
+}
+
+////////////////////////////////////////////////////////////////////
+///< SUPER-CHIP opcode functions
+///< Scroll distances are in pixels of the current mode
+////////////////////////////////////////////////////////////////////
+void chip8::opcode_00CN()
+{
+    ///< Scroll the selected planes down N rows
+    int n = opcode & 0x000F;
+    int height = displayHeight();
+
+    for(int p = 0; p < NUM_PLANES; p++)
+    {
+        if(planeMask & (1 << p))
+        {
+            memmove(gfx[p][n], gfx[p][0], sizeof(gfx[p][0]) * (height - n));
+            memset(gfx[p][0], 0, sizeof(gfx[p][0]) * n);
+        }
+    }
+    rehashDisplay();
+    drawFlag = true;
+    pc += 2;
+}
+void chip8::opcode_00FB()
+{
+    ///< Scroll the selected planes right 4 pixels
+    for(int p = 0; p < NUM_PLANES; p++)
+    {
+        if(!(planeMask & (1 << p)))
+        {
+            continue;
+        }
+        for(int y = 0; y < displayHeight(); y++)
+        {
+            gfx[p][y][1] = (gfx[p][y][1] >> 4) | (gfx[p][y][0] << 60);
+            gfx[p][y][0] >>= 4;
+            if(!hiresMode)
+            {
+                gfx[p][y][1] = 0;
+            }
+        }
+    }
+    rehashDisplay();
+    drawFlag = true;
+    pc += 2;
+}
+void chip8::opcode_00FC()
+{
+    ///< Scroll the selected planes left 4 pixels
+    for(int p = 0; p < NUM_PLANES; p++)
+    {
+        if(!(planeMask & (1 << p)))
+        {
+            continue;
+        }
+        for(int y = 0; y < displayHeight(); y++)
+        {
+            gfx[p][y][0] = (gfx[p][y][0] << 4) | (gfx[p][y][1] >> 60);
+            gfx[p][y][1] <<= 4;
+        }
+    }
+    rehashDisplay();
+    drawFlag = true;
+    pc += 2;
+}
+void chip8::opcode_00FD()
+{
+    ///< Exit the interpreter, the PC stays here from now on
+}
+void chip8::opcode_00FE()
+{
+    ///< Switch to 64x32, clearing every plane
+    hiresMode = false;
+    memset(gfx, 0, sizeof(gfx));
+    gfxHash = 0;
+    drawFlag = true;
+    pc += 2;
+}
+void chip8::opcode_00FF()
+{
+    ///< Switch to 128x64, clearing every plane
+    hiresMode = true;
+    memset(gfx, 0, sizeof(gfx));
+    gfxHash = 0;
+    drawFlag = true;
+    pc += 2;
+}
+void chip8::opcode_FX30()
+{
+    I = BIGFONT_START + (V[X_VAL] & 0xF) * 10;
+    pc += 2;
+}
+void chip8::opcode_FX75()
+{
+    for(int i = 0; i <= X_VAL && i < RPL_SIZE; i++)
+    {
+        rplFlags[i] = V[i];
+    }
+    pc += 2;
+}
+void chip8::opcode_FX85()
+{
+    for(int i = 0; i <= X_VAL && i < RPL_SIZE; i++)
+    {
+        V[i] = rplFlags[i];
+    }
+    pc += 2;
+}
+
+////////////////////////////////////////////////////////////////////
+///< XO-CHIP opcode functions
+////////////////////////////////////////////////////////////////////
+void chip8::opcode_00DN()
+{
+    ///< Scroll the selected planes up N rows
+    int n = opcode & 0x000F;
+    int height = displayHeight();
+
+    for(int p = 0; p < NUM_PLANES; p++)
+    {
+        if(planeMask & (1 << p))
+        {
+            memmove(gfx[p][0], gfx[p][n], sizeof(gfx[p][0]) * (height - n));
+            memset(gfx[p][height - n], 0, sizeof(gfx[p][0]) * n);
+        }
+    }
+    rehashDisplay();
+    drawFlag = true;
+    pc += 2;
+}
+void chip8::opcode_5XY2()
+{
+    ///< Save VX..VY to memory at I, in either order, I is unchanged
+    int x = X_VAL;
+    int y = Y_VAL;
+    int step = (x <= y) ? 1 : -1;
+    for(int i = 0, r = x; ; i++, r += step)
+    {
+        writeMemory(I + i, V[r]);
+        if(r == y)
+        {
+            break;
+        }
+    }
+    pc += 2;
+}
+void chip8::opcode_5XY3()
+{
+    ///< Load VX..VY from memory at I, in either order, I is unchanged
+    int x = X_VAL;
+    int y = Y_VAL;
+    int step = (x <= y) ? 1 : -1;
+    for(int i = 0, r = x; ; i++, r += step)
+    {
+        V[r] = memory[I + i];
+        if(r == y)
+        {
+            break;
+        }
+    }
+    pc += 2;
+}
+void chip8::opcode_F000()
+{
+    ///< I = NNNN from the following word
+    I = (memory[pc + 2] << 8) | memory[pc + 3];
+    pc += 4;
+}
+void chip8::opcode_FN01()
+{
+    ///< Select the planes DXYN, 00E0 and the scrolls work on
+    planeMask = X_VAL & 0x3;
+    pc += 2;
+}
+void chip8::opcode_F002()
+{
+    ///< Load the 16 byte audio pattern from I
+    for(int i = 0; i < AUDIO_PATTERN_SIZE; i++)
+    {
+        audioPattern[i] = memory[I + i];
+    }
+    pc += 2;
+}
+void chip8::opcode_FX3A()
+{
+    pitch = V[X_VAL];
     pc += 2;
 }
+
+////////////////////////////////////////////////////////////////////
+///< C interface
+////////////////////////////////////////////////////////////////////
+static_assert(CHIP8_QUIRKS_MODERN == QUIRKS_MODERN && CHIP8_QUIRKS_VIP == QUIRKS_VIP &&
+              CHIP8_QUIRKS_CHIP48 == QUIRKS_CHIP48 && CHIP8_QUIRKS_SCHIP == QUIRKS_SCHIP &&
+              CHIP8_QUIRKS_XOCHIP == QUIRKS_XOCHIP && CHIP8_QUIRKS_XOCHIP + 1 == NUM_QUIRKS,
+              "chip8_c.h quirk profiles must match QUIRKS_t");
+static_assert(CHIP8_TIMING_FIXED == TIMING_FIXED && CHIP8_TIMING_VIP == TIMING_VIP,
+              "chip8_c.h timing models must match TIMING_t");
+
+struct chip8_machine
+{
+    chip8 c8;
+    bool seeded;            ///< chip8_seed was called, loads keep its seed
+    unsigned int seed;
+};
+
+int chip8_abi_version(void)
+{
+    return CHIP8_ABI_VERSION;
+}
+
+chip8_machine *chip8_create(void)
+{
+    chip8_machine *machine = new (std::nothrow) chip8_machine;
+    if(machine != NULL)
+    {
+        machine->c8.setVerbose(false);
+        machine->seeded = false;
+        machine->seed = 0;
+    }
+    return machine;
+}
+
+void chip8_destroy(chip8_machine *machine)
+{
+    delete machine;
+}
+
+int chip8_load_rom(chip8_machine *machine, const unsigned char *data, size_t size, int quirks)
+{
+    if(quirks < 0 || quirks >= NUM_QUIRKS)
+    {
+        return 0;
+    }
+    ///< The XO-CHIP profile allocates its 64k here, failing must not unwind into C
+    try
+    {
+        if(!machine->c8.loadRom(data, size, (QUIRKS_t)quirks))
+        {
+            return 0;
+        }
+    }
+    catch(...)
+    {
+        return 0;
+    }
+
+    ///< Loading reseeds from the clock, an explicit seed wins so runs stay reproducible
+    if(machine->seeded)
+    {
+        machine->c8.seedRandom(machine->seed);
+    }
+    return 1;
+}
+
+void chip8_seed(chip8_machine *machine, unsigned int seed)
+{
+    machine->seeded = true;
+    machine->seed = seed;
+    machine->c8.seedRandom(seed);
+}
+
+void chip8_set_timing(chip8_machine *machine, int timing)
+{
+    machine->c8.setTiming(timing == TIMING_VIP ? TIMING_VIP : TIMING_FIXED);
+}
+
+void chip8_run_instructions(chip8_machine *machine, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        machine->c8.emulateCycle();
+    }
+}
+
+void chip8_run_frames(chip8_machine *machine, int count, int cyclesPerFrame)
+{
+    for(int i = 0; i < count; i++)
+    {
+        machine->c8.emulateFrame(cyclesPerFrame);
+    }
+}
+
+void chip8_set_keys(chip8_machine *machine, unsigned short mask)
+{
+    for(int k = 0; k < KEYPAD_SIZE; k++)
+    {
+        machine->c8.key[k] = (mask >> k) & 1;
+    }
+}
+
+int chip8_display_width(const chip8_machine *machine)
+{
+    return machine->c8.displayWidth();
+}
+
+int chip8_display_height(const chip8_machine *machine)
+{
+    return machine->c8.displayHeight();
+}
+
+size_t chip8_read_framebuffer(const chip8_machine *machine, unsigned char *out, size_t size)
+{
+    const chip8 &c8 = machine->c8;
+    int width = c8.displayWidth();
+    int height = c8.displayHeight();
+    size_t needed = (size_t)width * height;
+
+    if(out == NULL || size < needed)
+    {
+        return needed;
+    }
+    for(int y = 0; y < height; y++)
+    {
+        for(int x = 0; x < width; x++)
+        {
+            out[y * width + x] = (unsigned char)c8.pixel(x, y);
+        }
+    }
+    return needed;
+}
+
+int chip8_sound_active(const chip8_machine *machine)
+{
+    return machine->c8.soundActive() ? 1 : 0;
+}
+
+unsigned long long chip8_state_hash(const chip8_machine *machine)
+{
+    return machine->c8.stateHash();
+}
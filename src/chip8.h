@@ -1,11 +1,108 @@
+#ifndef CHIP8_H
+#define CHIP8_H
+
+#include <stddef.h>
+#include "quirks.h"
+
 
 #define MEMORY_SIZE     4096
+///< XO-CHIP address space, only allocated for XO-CHIP programs
+#define XO_MEMORY_SIZE  65536
 #define GFX_SIZE        64*32
+#define GFX_WIDTH       64
+#define GFX_HEIGHT      32
+///< SUPER-CHIP high resolution mode
+#define HIRES_WIDTH     128
+#define HIRES_HEIGHT    64
+///< Display rows are bit packed, MSB of word 0 is the leftmost pixel
+#define GFX_ROW_WORDS   (HIRES_WIDTH / 64)
+#define RPL_SIZE        8
+///< XO-CHIP bit planes and audio pattern buffer
+#define NUM_PLANES      2
+#define AUDIO_PATTERN_SIZE  16
 #define STACK_SIZE      16
 #define REGISTER_SIZE   16
 #define KEYPAD_SIZE     16
 
-#define NUM_OPCODES     35
+#define NUM_OPCODES     51
+#define ROM_START       0x200
+#define MAX_ROM_SIZE    (MEMORY_SIZE - ROM_START)
+#define XO_MAX_ROM_SIZE (XO_MEMORY_SIZE - ROM_START)
+
+///< Opcode sequences the frame loop dispatches as one fused handler
+typedef enum {
+    FUSE_SKIP_JUMP,     ///< 3XNN/4XNN followed by 1NNN
+    FUSE_LOAD_RUN,      ///< Two or more 6XNN in a row
+    FUSE_INDEX_DRAW,    ///< ANNN followed by DXYN
+    FUSE_DELAY_WAIT,    ///< FX07, 3X00, 1NNN back to the FX07
+    NUM_FUSIONS
+} FUSION_t;
+
+///< Opcodes in decode order, handler tables are indexed by these and -1 is unknown
+typedef enum {
+    OPCODE_ONNN,
+    OPCODE_00E0,
+    OPCODE_00EE,
+    OPCODE_1NNN,
+    OPCODE_2NNN,
+    OPCODE_3XNN,
+    OPCODE_4XNN,
+    OPCODE_5XY0,
+    OPCODE_6XNN,
+    OPCODE_7XNN,
+    OPCODE_8XY0,
+    OPCODE_8XY1,
+    OPCODE_8XY2,
+    OPCODE_8XY3,
+    OPCODE_8XY4,
+    OPCODE_8XY5,
+    OPCODE_8XY6,
+    OPCODE_8XY7,
+    OPCODE_8XYE,
+    OPCODE_9XY0,
+    OPCODE_ANNN,
+    OPCODE_BNNN,
+    OPCODE_CXNN,
+    OPCODE_DXYN,
+    OPCODE_EX9E,
+    OPCODE_EXA1,
+    OPCODE_FX07,
+    OPCODE_FX0A,
+    OPCODE_FX15,
+    OPCODE_FX18,
+    OPCODE_FX1E,
+    OPCODE_FX29,
+    OPCODE_FX33,
+    OPCODE_FX55,
+    OPCODE_FX65,
+    OPCODE_00CN,
+    OPCODE_00FB,
+    OPCODE_00FC,
+    OPCODE_00FD,
+    OPCODE_00FE,
+    OPCODE_00FF,
+    OPCODE_FX30,
+    OPCODE_FX75,
+    OPCODE_FX85,
+    OPCODE_00DN,
+    OPCODE_5XY2,
+    OPCODE_5XY3,
+    OPCODE_F000,
+    OPCODE_FN01,
+    OPCODE_F002,
+    OPCODE_FX3A
+} OPCODE_t;
+
+///< How instructions are charged against a frame
+typedef enum {
+    TIMING_FIXED,       ///< Every instruction costs one, a frame is the cycles passed to emulateFrame
+    TIMING_VIP          ///< COSMAC VIP machine cycles per opcode, DXYN waits for vertical blank
+} TIMING_t;
+
+///< COSMAC VIP: 1.76 MHz / 8 clocks per machine cycle / 60 Hz
+#define VIP_CYCLES_PER_FRAME    3668
+///< Display DMA steals 8 machine cycles on each of the 128 scanlines
+#define VIP_DISPLAY_CYCLES      1024
 
 #define X_VAL   ((opcode & 0x0F00) >> 8)
 #define Y_VAL   ((opcode & 0x00F0) >> 4)
@@ -44,41 +141,136 @@
  * 
  */
 
-class chip8
+/**
+ * Chip 8 memory. Normally the 4k array inside the object, switched to a
+ * 64k heap block for XO-CHIP. Copies are deep so a chip8 can be copied
+ * as a snapshot.
+ */
+class chip8Memory
 {
     public:
+        chip8Memory() : data(small), mask(MEMORY_SIZE - 1), length(MEMORY_SIZE), big(NULL) {}
+        chip8Memory(const chip8Memory &other) : data(small), mask(MEMORY_SIZE - 1), length(MEMORY_SIZE), big(NULL) { *this = other; }
+        ~chip8Memory() { delete[] big; }
+        chip8Memory &operator=(const chip8Memory &other);
+
+        ///< Addresses wrap around the address space, masking keeps every access in bounds without a branch
+        unsigned char &operator[](unsigned int address) { return data[address & mask]; }
+        const unsigned char &operator[](unsigned int address) const { return data[address & mask]; }
+        unsigned int size() const { return length; }
+        ///< Switches between 4k and 64k, the first 4k are kept
+        void setExtended(bool extended);
+        void clear();
+
+    private:
+        ///< Used on every access, the header of the class so they share a line with the chip8 registers
+        unsigned char *data;
+        unsigned int mask;
+        unsigned int length;
+        unsigned char *big;
+        unsigned char small[MEMORY_SIZE];
+};
+
+/**
+ * Layout: the registers and the selected interpreter loops sit in the first
+ * 64 byte cache line, the memory header and the 4k memory follow and colder
+ * state, the running hashes included, comes after it. Opcode tables are
+ * static and shared. chip8.cpp checks the offsets.
+ */
+#define CACHE_LINE_SIZE 64
+
+class alignas(CACHE_LINE_SIZE) chip8
+{
+    friend class chip8Debugger;
+    friend class chip8Verifier;
+    friend class chip8Profiler;
+    friend class chip8Explorer;
+    friend class chip8Decoder;
+
+    private:
+        ///< Hot registers, first cache line
+        unsigned short pc;
+        unsigned short I;
+        unsigned short sp;
+        ///< Opcodes in the chip8 are 2 bytes long
+        unsigned short opcode;
+        ///< The Chip 8 has 15 general purpose registers and a 16th register used for a carry flag
+        unsigned char V[REGISTER_SIZE];
+        unsigned char delay_timer;
+        unsigned char sound_timer;
+        ///< XO-CHIP drawing planes (bit mask) and SUPER-CHIP display mode
+        unsigned char planeMask;
+        bool hiresMode;
+        ///< Per instance random state for CXNN, so instances never share rand()
+        unsigned int rngState;
+        ///< Interpreter loops of the selected quirk profile: single step, frame and VIP timed
+        typedef void (*ExecuteFn)(chip8 &c8, int cycles);
+        ExecuteFn execute;
+        ExecuteFn executeFrame;
+        ExecuteFn executeVip;
+        ///< VIP timing: machine cycles used so far in the current frame
+        TIMING_t timing;
+        int frameCycles;
+        ///< The Chip 8 has 4k in memory, XO-CHIP has 64k. Its pointer and mask start the second line
+        chip8Memory memory;
+
+    public:
+        chip8();
+
         bool drawFlag = false;
         ///< Chip 8 keypad
         unsigned char key[KEYPAD_SIZE];
-        ///< Chip 8 graphics
-        unsigned char gfx[GFX_SIZE];
+        ///< Chip 8 graphics, one bit per pixel per plane. Lores only uses word 0 of rows 0-31
+        unsigned long long gfx[NUM_PLANES][HIRES_HEIGHT][GFX_ROW_WORDS];
+
+        bool hires() const { return hiresMode; }
+        int displayWidth() const { return hiresMode ? HIRES_WIDTH : GFX_WIDTH; }
+        int displayHeight() const { return hiresMode ? HIRES_HEIGHT : GFX_HEIGHT; }
+        ///< Colour index 0-3, bit 0 from plane 1 and bit 1 from plane 2
+        int pixel(int x, int y) const
+        {
+            return ((gfx[0][y][x >> 6] >> (63 - (x & 63))) & 1) |
+                   (((gfx[1][y][x >> 6] >> (63 - (x & 63))) & 1) << 1);
+        }
+        bool soundActive() const { return sound_timer > 0; }
+        unsigned short getPc() const { return pc; }
+        ///< Stuck in FX0A with no key down and both timers at zero, so further frames change nothing
+        bool waitingForKey() const;
+        const unsigned char *getRegisters() const { return V; }
+        ///< Bytes used by one instance, including the XO-CHIP memory block when allocated
+        size_t footprint() const { return sizeof(chip8) + (memory.size() > MEMORY_SIZE ? memory.size() : 0); }
+        ///< Row y of the display scaled to 64x32 with all planes ORed, hires pixels are ORed in 2x2 blocks
+        unsigned long long loresRow(int y) const;
         
         void initialize();
         void emulateCycle();
-        bool loadGame(const char * romName);
+        void emulateFrame(int cycles);
+        bool loadGame(const char * romName, QUIRKS_t quirks = QUIRKS_MODERN);
+        bool loadRom(const unsigned char *data, size_t size, QUIRKS_t quirks = QUIRKS_MODERN);
+        ///< Selects the interpreter loop compiled for the given quirk profile
+        void setQuirks(QUIRKS_t quirks);
+        QUIRKS_t getQuirks() const { return quirks; }
+        ///< Fused dispatch of common opcode sequences in emulateFrame, on by default
+        void setFusion(bool enable);
+        ///< Number of times each fusion fired since the last initialize
+        unsigned long fusionCount(FUSION_t fusion) const { return fusionStats[fusion]; }
+        static const char *fusionName(FUSION_t fusion);
+        ///< Cycle counting model, TIMING_FIXED by default
+        void setTiming(TIMING_t mode) { timing = mode; }
+        TIMING_t getTiming() const { return timing; }
+        void seedRandom(unsigned int seed);
+        ///< Print unknown opcodes and BEEP, on by default
+        void setVerbose(bool enable) { verbose = enable; }
+
+        ///< 64 bit hash of the machine state, memory and gfx are hashed incrementally
+        unsigned long long stateHash() const;
+        ///< Same value as stateHash() but recomputed from scratch
+        unsigned long long computeStateHash() const;
 
         typedef void (chip8::*OpcodeMemFun)();
 
-        OpcodeMemFun opcodeArray[NUM_OPCODES] = 
-        {&chip8::opcode_ONNN, &chip8::opcode_00E0,
-        &chip8::opcode_00EE, &chip8::opcode_1NNN,
-        &chip8::opcode_2NNN, &chip8::opcode_3XNN,
-        &chip8::opcode_4XNN, &chip8::opcode_5XY0,
-        &chip8::opcode_6XNN, &chip8::opcode_7XNN,
-        &chip8::opcode_8XY0, &chip8::opcode_8XY1,
-        &chip8::opcode_8XY2, &chip8::opcode_8XY3,
-        &chip8::opcode_8XY4, &chip8::opcode_8XY5,
-        &chip8::opcode_8XY6, &chip8::opcode_8XY7,
-        &chip8::opcode_8XYE, &chip8::opcode_9XY0,
-        &chip8::opcode_ANNN, &chip8::opcode_BNNN,
-        &chip8::opcode_CXNN, &chip8::opcode_DXYN,
-        &chip8::opcode_EX9E, &chip8::opcode_EXA1,
-        &chip8::opcode_FX07, &chip8::opcode_FX0A,
-        &chip8::opcode_FX15, &chip8::opcode_FX18,
-        &chip8::opcode_FX1E, &chip8::opcode_FX29,
-        &chip8::opcode_FX33, &chip8::opcode_FX55,
-        &chip8::opcode_FX65
-        };
+        ///< Handler of every OPCODE_t for the default profile, shared by all instances
+        static const OpcodeMemFun opcodeArray[NUM_OPCODES];
         // void (chip8::*opcode_function_table[NUM_OPCODES])() = 
         // {&chip8::opcode_ONNN, &chip8::opcode_00E0,
         // &chip8::opcode_00EE, &chip8::opcode_1NNN,
@@ -101,33 +293,49 @@ class chip8
         // };
 
     private:
-        ///< Opcodes in the chip8 are 2 bytes long
-        unsigned short opcode;
-        unsigned short mappedOpcode;
-        ///< The Chip 8 has 4k in memory
-        unsigned char memory[MEMORY_SIZE];
-        ///< The Chip 8 has 15 general purpose registers and a 16th register used for a carry flag
-        unsigned char V[REGISTER_SIZE];
-        ///< Index register and program counter
-        unsigned short I;
-        unsigned short pc;
-        ///< Chip 8 timers
-        unsigned char delay_timer;
-        unsigned char sound_timer;
-        ///< Chip 8 stack and stack pointer
+        ///< Chip 8 stack
         unsigned short stack[STACK_SIZE];
-        unsigned short sp;
+        ///< HP48 RPL user flags
+        unsigned char rplFlags[RPL_SIZE];
+        ///< XO-CHIP audio pattern and pitch
+        unsigned char audioPattern[AUDIO_PATTERN_SIZE];
+        unsigned char pitch;
 
 
 
 
         // void (chip8::*opcode_function_table[2])() = {&chip8::opcode_ONNN, &chip8::opcode_00E0};
 
+        ///< Running hashes of memory and gfx, updated on every write
+        unsigned long long memHash;
+        unsigned long long gfxHash;
+        QUIRKS_t quirks;
+        bool fusion;
+        bool verbose;
+        unsigned long fusionStats[NUM_FUSIONS];
+
         unsigned short fetchOpcode();
+        template <class Q> void selectLoops();
+        template <class Q, bool FUSE> void executeCycles(int cycles);
+        template <class Q> int executeFused(int remaining);
+        template <class Q> void executeTimed(int cycles);
+        template <class Q, bool FUSE> static void runCycles(chip8 &c8, int cycles) { c8.executeCycles<Q, FUSE>(cycles); }
+        template <class Q> static void runTimed(chip8 &c8, int cycles) { c8.executeTimed<Q>(cycles); }
+        bool nextVipFrame();
+        bool updateTimers();
+        unsigned char nextRandom();
         void clearDisp();
+        void rehashDisplay();
+        template <class Q> void drawSpriteRow(int plane, int row, unsigned int bits, int width, int x);
+        template <class Q> void skipNext();
+        void writeMemory(unsigned int address, unsigned char value);
+        unsigned long long registerHash() const;
 
         ///< Opcode Helper functions
-        int opcodeMap(unsigned short opcode);
+        ///< OPCODE_t of an opcode under a profile, -1 if the profile has no such opcode
+        template <class Q> static int decodeOpcode(unsigned short opcode);
+        static int decodeOpcode(unsigned short opcode, QUIRKS_t profile);
+        template <class Q> int opcodeMap(unsigned short opcode);
 
         ///< Opcode functions
         void opcode_ONNN();
@@ -135,27 +343,27 @@ class chip8
         void opcode_00EE();
         void opcode_1NNN();
         void opcode_2NNN();
-        void opcode_3XNN();
-        void opcode_4XNN();
-        void opcode_5XY0();
+        template <class Q> void opcode_3XNN();
+        template <class Q> void opcode_4XNN();
+        template <class Q> void opcode_5XY0();
         void opcode_6XNN();
         void opcode_7XNN();
         void opcode_8XY0();
-        void opcode_8XY1();
-        void opcode_8XY2();
-        void opcode_8XY3();
+        template <class Q> void opcode_8XY1();
+        template <class Q> void opcode_8XY2();
+        template <class Q> void opcode_8XY3();
         void opcode_8XY4();
         void opcode_8XY5();
-        void opcode_8XY6();
+        template <class Q> void opcode_8XY6();
         void opcode_8XY7();
-        void opcode_8XYE();
-        void opcode_9XY0();
+        template <class Q> void opcode_8XYE();
+        template <class Q> void opcode_9XY0();
         void opcode_ANNN();
-        void opcode_BNNN();
+        template <class Q> void opcode_BNNN();
         void opcode_CXNN();
-        void opcode_DXYN();
-        void opcode_EX9E();
-        void opcode_EXA1();
+        template <class Q> void opcode_DXYN();
+        template <class Q> void opcode_EX9E();
+        template <class Q> void opcode_EXA1();
         void opcode_FX07();
         void opcode_FX0A();
         void opcode_FX15();
@@ -163,6 +371,28 @@ class chip8
         void opcode_FX1E();
         void opcode_FX29();
         void opcode_FX33();
-        void opcode_FX55();
-        void opcode_FX65();
-};
\ No newline at end of file
+        template <class Q> void opcode_FX55();
+        template <class Q> void opcode_FX65();
+
+        ///< SUPER-CHIP opcode functions
+        void opcode_00CN();
+        void opcode_00FB();
+        void opcode_00FC();
+        void opcode_00FD();
+        void opcode_00FE();
+        void opcode_00FF();
+        void opcode_FX30();
+        void opcode_FX75();
+        void opcode_FX85();
+
+        ///< XO-CHIP opcode functions
+        void opcode_00DN();
+        void opcode_5XY2();
+        void opcode_5XY3();
+        void opcode_F000();
+        void opcode_FN01();
+        void opcode_F002();
+        void opcode_FX3A();
+};
+
+#endif // CHIP8_H
@@ -0,0 +1,68 @@
+#ifndef CHIP8_C_H
+#define CHIP8_C_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///< Bumped whenever a function signature or behaviour changes incompatibly
+#define CHIP8_ABI_VERSION   2
+
+///< Quirk profiles for chip8_load_rom and chip8_env_load_rom
+#define CHIP8_QUIRKS_MODERN     0
+#define CHIP8_QUIRKS_VIP        1
+#define CHIP8_QUIRKS_CHIP48     2
+#define CHIP8_QUIRKS_SCHIP      3
+#define CHIP8_QUIRKS_XOCHIP     4
+
+///< Cycle counting models for chip8_set_timing
+#define CHIP8_TIMING_FIXED      0   ///< One cycle per instruction
+#define CHIP8_TIMING_VIP        1   ///< COSMAC VIP machine cycles, DXYN waits for vertical blank
+
+/**
+ * Single chip8 machine behind an opaque handle. Handles share no state,
+ * so any number of them can be used from different threads, one thread
+ * per handle at a time. Nothing is printed.
+ */
+typedef struct chip8_machine chip8_machine;
+
+int chip8_abi_version(void);
+
+///< Returns NULL when out of memory
+chip8_machine *chip8_create(void);
+void chip8_destroy(chip8_machine *machine);
+
+///< quirks is a CHIP8_QUIRKS_* profile. Returns 0 if the ROM does not fit or memory runs out
+int chip8_load_rom(chip8_machine *machine, const unsigned char *data, size_t size, int quirks);
+///< The seed is kept across later loads; until it is called each load seeds from the clock
+void chip8_seed(chip8_machine *machine, unsigned int seed);
+///< timing is CHIP8_TIMING_FIXED or CHIP8_TIMING_VIP
+void chip8_set_timing(chip8_machine *machine, int timing);
+
+///< Runs count single instructions, the timers tick after each one
+void chip8_run_instructions(chip8_machine *machine, int count);
+///< Runs count 60Hz frames of cyclesPerFrame instructions each
+void chip8_run_frames(chip8_machine *machine, int count, int cyclesPerFrame);
+
+///< Bit N of mask is key N
+void chip8_set_keys(chip8_machine *machine, unsigned short mask);
+
+int chip8_display_width(const chip8_machine *machine);
+int chip8_display_height(const chip8_machine *machine);
+/**
+ * Writes one byte per pixel (colour index 0-3), row by row, into out.
+ * Returns the number of bytes the current display needs; nothing is
+ * written if size is smaller than that.
+ */
+size_t chip8_read_framebuffer(const chip8_machine *machine, unsigned char *out, size_t size);
+///< Non zero while the sound timer is running
+int chip8_sound_active(const chip8_machine *machine);
+unsigned long long chip8_state_hash(const chip8_machine *machine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHIP8_C_H
@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include "chip8env.h"
+
+#define SCREEN_WIDTH    64
+#define SCREEN_HEIGHT   32
+
+chip8Env::chip8Env(int numEnvs, int numThreads, int cyclesPerFrame)
+    : envs(numEnvs), cyclesPerFrame(cyclesPerFrame), generation(0), pending(0), quit(false)
+{
+    if(numThreads <= 0)
+    {
+        numThreads = std::thread::hardware_concurrency();
+    }
+    if(numThreads > numEnvs)
+    {
+        numThreads = numEnvs;
+    }
+    if(numThreads < 1)
+    {
+        numThreads = 1;
+    }
+
+    ///< Slice 0 is run by the caller, the pool covers the rest
+    try
+    {
+        for(int i = 1; i < numThreads; i++)
+        {
+            workers.push_back(std::thread(&chip8Env::workerLoop, this, i));
+        }
+    }
+    catch(...)
+    {
+        ///< The destructor will not run, joinable threads left behind would terminate
+        stopWorkers();
+        throw;
+    }
+}
+
+chip8Env::~chip8Env()
+{
+    stopWorkers();
+}
+
+void chip8Env::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = true;
+    }
+    startCond.notify_all();
+
+    for(size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+}
+
+bool chip8Env::loadGame(const char *romName, QUIRKS_t quirks)
+{
+    romFile file;
+    if(!file.open(romName))
+    {
+        fputs("File Error", stderr);
+        return false;
+    }
+    if(!loadRom(file.data(), file.size(), quirks))
+    {
+        fputs("ROM too large", stderr);
+        return false;
+    }
+    return true;
+}
+
+bool chip8Env::loadRom(const unsigned char *data, size_t size, QUIRKS_t quirks)
+{
+    ///< Every reset copies the image, a log line per unknown opcode per env would swamp a batch
+    image.setVerbose(false);
+    return image.load(data, size, NULL, quirks);
+}
+
+void chip8Env::reset(unsigned int seed, unsigned char *obs, chip8_obs_t format)
+{
+    job = JOB_RESET;
+    jobSeed = seed;
+    jobActions = NULL;
+    jobFrames = 0;
+    jobObs = obs;
+    jobFormat = format;
+    dispatch();
+}
+
+void chip8Env::step(const unsigned short *actions, int frames, unsigned char *obs, chip8_obs_t format)
+{
+    job = JOB_STEP;
+    jobActions = actions;
+    jobFrames = frames;
+    jobObs = obs;
+    jobFormat = format;
+    dispatch();
+}
+
+size_t chip8Env::obsSize(chip8_obs_t format)
+{
+    switch(format)
+    {
+        case CHIP8_OBS_PACKED:
+            return GFX_SIZE / 8;
+        case CHIP8_OBS_HALF:
+            return GFX_SIZE / 4;
+        default:
+            return GFX_SIZE;
+    }
+}
+
+void chip8Env::dispatch()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending = (int)workers.size();
+        generation++;
+    }
+    startCond.notify_all();
+
+    runSlice(0);
+
+    std::unique_lock<std::mutex> guard(lock);
+    while(pending > 0)
+    {
+        doneCond.wait(guard);
+    }
+}
+
+void chip8Env::workerLoop(int slice)
+{
+    unsigned long seen = 0;
+
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while(!quit && generation == seen)
+            {
+                startCond.wait(guard);
+            }
+            if(quit)
+            {
+                return;
+            }
+            seen = generation;
+        }
+
+        runSlice(slice);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            last = (--pending == 0);
+        }
+        if(last)
+        {
+            doneCond.notify_one();
+        }
+    }
+}
+
+void chip8Env::runSlice(int slice)
+{
+    int numSlices = (int)workers.size() + 1;
+    int begin = (int)(((long)envs.size() * slice) / numSlices);
+    int end = (int)(((long)envs.size() * (slice + 1)) / numSlices);
+    size_t stride = obsSize(jobFormat);
+
+    for(int i = begin; i < end; i++)
+    {
+        chip8 &c8 = envs[i];
+
+        if(job == JOB_RESET)
+        {
+            image.reset(c8);
+            c8.seedRandom(jobSeed + i);
+        }
+        else
+        {
+            unsigned short mask = jobActions[i];
+            for(int k = 0; k < KEYPAD_SIZE; k++)
+            {
+                c8.key[k] = (mask >> k) & 1;
+            }
+            for(int f = 0; f < jobFrames; f++)
+            {
+                c8.emulateFrame(cyclesPerFrame);
+            }
+        }
+
+        if(jobObs != NULL)
+        {
+            writeObs(c8, jobObs + stride * i, jobFormat);
+        }
+    }
+}
+
+void chip8Env::writeObs(const chip8 &c8, unsigned char *out, chip8_obs_t format) const
+{
+    ///< Observations are always 64x32, hires displays are ORed down in 2x2 blocks
+    switch(format)
+    {
+        case CHIP8_OBS_PACKED:
+            for(int y = 0; y < SCREEN_HEIGHT; y++)
+            {
+                unsigned long long row = c8.loresRow(y);
+                for(int b = 0; b < SCREEN_WIDTH / 8; b++)
+                {
+                    out[y * (SCREEN_WIDTH / 8) + b] = (unsigned char)(row >> (56 - b * 8));
+                }
+            }
+        break;
+        case CHIP8_OBS_HALF:
+            for(int y = 0; y < SCREEN_HEIGHT / 2; y++)
+            {
+                unsigned long long row = c8.loresRow(y * 2) | c8.loresRow(y * 2 + 1);
+                for(int x = 0; x < SCREEN_WIDTH / 2; x++)
+                {
+                    out[y * (SCREEN_WIDTH / 2) + x] = ((row >> (62 - x * 2)) & 0x3) != 0;
+                }
+            }
+        break;
+        default:
+            for(int y = 0; y < SCREEN_HEIGHT; y++)
+            {
+                unsigned long long row = c8.loresRow(y);
+                for(int x = 0; x < SCREEN_WIDTH; x++)
+                {
+                    out[y * SCREEN_WIDTH + x] = (row >> (63 - x)) & 1;
+                }
+            }
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+///< C interface
+////////////////////////////////////////////////////////////////////
+struct chip8_env
+{
+    chip8Env env;
+    chip8_env(int numEnvs, int numThreads, int cyclesPerFrame)
+        : env(numEnvs, numThreads, cyclesPerFrame) {}
+};
+
+chip8_env *chip8_env_create(int numEnvs, int numThreads, int cyclesPerFrame)
+{
+    if(numEnvs <= 0)
+    {
+        return NULL;
+    }
+    if(cyclesPerFrame <= 0)
+    {
+        cyclesPerFrame = ENV_CYCLES_PER_FRAME;
+    }
+    ///< Allocation or thread creation failing must not unwind into C
+    try
+    {
+        return new (std::nothrow) chip8_env(numEnvs, numThreads, cyclesPerFrame);
+    }
+    catch(...)
+    {
+        return NULL;
+    }
+}
+
+void chip8_env_destroy(chip8_env *env)
+{
+    delete env;
+}
+
+int chip8_env_load_rom(chip8_env *env, const unsigned char *data, size_t size, int quirks)
+{
+    if(quirks < 0 || quirks >= NUM_QUIRKS)
+    {
+        return 0;
+    }
+    return env->env.loadRom(data, size, (QUIRKS_t)quirks) ? 1 : 0;
+}
+
+int chip8_env_size(const chip8_env *env)
+{
+    return env->env.size();
+}
+
+size_t chip8_env_obs_size(chip8_obs_t format)
+{
+    return chip8Env::obsSize(format);
+}
+
+void chip8_env_reset(chip8_env *env, unsigned int seed, unsigned char *obs, chip8_obs_t format)
+{
+    env->env.reset(seed, obs, format);
+}
+
+void chip8_env_step(chip8_env *env, const unsigned short *actions, int frames,
+                    unsigned char *obs, chip8_obs_t format)
+{
+    env->env.step(actions, frames, obs, format);
+}
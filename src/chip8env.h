@@ -0,0 +1,69 @@
+#ifndef CHIP8ENV_H
+#define CHIP8ENV_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "chip8.h"
+#include "romdb.h"
+#include "chip8env_c.h"
+
+#define ENV_CYCLES_PER_FRAME    10
+
+/**
+ * Batch of chip8 instances stepped together across a persistent worker pool.
+ * Every instance runs the same ROM. Observations are written straight into
+ * the caller's buffer, nothing is allocated per step.
+ */
+class chip8Env
+{
+    public:
+        chip8Env(int numEnvs, int numThreads = 0, int cyclesPerFrame = ENV_CYCLES_PER_FRAME);
+        ~chip8Env();
+
+        bool loadGame(const char *romName, QUIRKS_t quirks = QUIRKS_MODERN);
+        bool loadRom(const unsigned char *data, size_t size, QUIRKS_t quirks = QUIRKS_MODERN);
+
+        ///< Instance i is seeded with seed + i
+        void reset(unsigned int seed, unsigned char *obs = NULL, chip8_obs_t format = CHIP8_OBS_FULL);
+        void step(const unsigned short *actions, int frames, unsigned char *obs, chip8_obs_t format);
+
+        int size() const { return (int)envs.size(); }
+        chip8 &instance(int index) { return envs[index]; }
+
+        static size_t obsSize(chip8_obs_t format);
+
+    private:
+        enum jobKind { JOB_RESET, JOB_STEP };
+
+        std::vector<chip8> envs;
+        ///< Booted once per ROM, every reset is a copy of it
+        romImage image;
+        int cyclesPerFrame;
+
+        ///< Worker pool, the calling thread always runs slice 0
+        std::vector<std::thread> workers;
+        std::mutex lock;
+        std::condition_variable startCond;
+        std::condition_variable doneCond;
+        unsigned long generation;
+        int pending;
+        bool quit;
+
+        ///< Current job, only written while all workers are idle
+        jobKind job;
+        unsigned int jobSeed;
+        const unsigned short *jobActions;
+        int jobFrames;
+        unsigned char *jobObs;
+        chip8_obs_t jobFormat;
+
+        void dispatch();
+        void workerLoop(int slice);
+        void stopWorkers();
+        void runSlice(int slice);
+        void writeObs(const chip8 &c8, unsigned char *out, chip8_obs_t format) const;
+};
+
+#endif // CHIP8ENV_H
@@ -0,0 +1,45 @@
+#ifndef CHIP8ENV_C_H
+#define CHIP8ENV_C_H
+
+#include <stddef.h>
+#include "chip8_c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Observation layouts written by step/reset.
+ * FULL   : 64x32 bytes, one byte per pixel (0 or 1)
+ * PACKED : 64x32 bits, 8 pixels per byte, MSB is the leftmost pixel
+ * HALF   : 32x16 bytes, each byte is the OR of a 2x2 pixel block
+ */
+typedef enum
+{
+    CHIP8_OBS_FULL = 0,
+    CHIP8_OBS_PACKED,
+    CHIP8_OBS_HALF
+} chip8_obs_t;
+
+typedef struct chip8_env chip8_env;
+
+///< numThreads <= 0 uses every hardware thread
+chip8_env *chip8_env_create(int numEnvs, int numThreads, int cyclesPerFrame);
+void chip8_env_destroy(chip8_env *env);
+
+///< quirks is a CHIP8_QUIRKS_* profile from chip8_c.h
+int chip8_env_load_rom(chip8_env *env, const unsigned char *data, size_t size, int quirks);
+int chip8_env_size(const chip8_env *env);
+size_t chip8_env_obs_size(chip8_obs_t format);
+
+///< obs may be NULL, otherwise it must hold numEnvs * chip8_env_obs_size(format) bytes
+void chip8_env_reset(chip8_env *env, unsigned int seed, unsigned char *obs, chip8_obs_t format);
+///< actions holds one 16 bit key mask per environment, bit N is key N
+void chip8_env_step(chip8_env *env, const unsigned short *actions, int frames,
+                    unsigned char *obs, chip8_obs_t format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHIP8ENV_C_H
@@ -0,0 +1,341 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "access.h"
+#include "debugger.h"
+
+#define DBG_DEFAULT_CYCLES  1000000UL
+
+static const char *stopNames[] = {
+    "done", "step", "breakpoint", "read watchpoint", "write watchpoint", "condition"
+};
+
+chip8Debugger::chip8Debugger(chip8 &target)
+    : c8(target), totalCycles(0), lastAddress(0)
+{
+}
+
+///< Addresses are kept as given, lookups wrap them to the loaded ROM's memory
+void chip8Debugger::setBreakpoint(unsigned short address, bool enable)
+{
+    breakpoints[address & (XO_MEMORY_SIZE - 1)] = enable;
+}
+
+void chip8Debugger::setWatchpoint(unsigned short address, bool onRead, bool onWrite)
+{
+    readWatch[address & (XO_MEMORY_SIZE - 1)] = onRead;
+    writeWatch[address & (XO_MEMORY_SIZE - 1)] = onWrite;
+}
+
+void chip8Debugger::addCondition(int reg, COND_t cmp, unsigned short value)
+{
+    condition c = {reg, cmp, value};
+    conditions.push_back(c);
+}
+
+void chip8Debugger::clearConditions()
+{
+    conditions.clear();
+}
+
+bool chip8Debugger::armed() const
+{
+    return breakpoints.any() || readWatch.any() || writeWatch.any() || !conditions.empty();
+}
+
+STOP_t chip8Debugger::run(unsigned long maxCycles)
+{
+    ///< Pick the loop once, the unarmed loop pays nothing per cycle
+    if(!armed())
+    {
+        return runFast(maxCycles);
+    }
+    return runChecked(maxCycles, false, 0, false);
+}
+
+STOP_t chip8Debugger::step()
+{
+    lastAddress = c8.pc;
+    c8.emulateCycle();
+    totalCycles++;
+    return STOP_STEP;
+}
+
+STOP_t chip8Debugger::stepOver(unsigned long maxCycles)
+{
+    if((c8.fetchOpcode() & 0xF000) != 0x2000)
+    {
+        return step();
+    }
+
+    ///< Run the call until the stack pointer comes back down. The call's
+    ///< first instruction has not been looked at yet, so it is checked too
+    unsigned short returnSp = c8.sp;
+    step();
+    return runChecked(maxCycles, true, returnSp, true);
+}
+
+STOP_t chip8Debugger::runFast(unsigned long maxCycles)
+{
+    for(unsigned long i = 0; i < maxCycles; i++)
+    {
+        c8.emulateCycle();
+    }
+    totalCycles += maxCycles;
+    lastAddress = c8.pc;
+    return STOP_DONE;
+}
+
+STOP_t chip8Debugger::runChecked(unsigned long maxCycles, bool untilReturn, unsigned short returnSp, bool checkFirst)
+{
+    ///< Conditions only trigger when they become true
+    bool wasTrue = checkConditions();
+
+    for(unsigned long i = 0; i < maxCycles; i++)
+    {
+        ///< The first instruction is not stopped on unless asked, so continuing from a stop moves on
+        STOP_t reason = checkBefore(i == 0 && !checkFirst);
+        if(reason != STOP_DONE)
+        {
+            return reason;
+        }
+
+        c8.emulateCycle();
+        totalCycles++;
+
+        if(untilReturn && c8.sp == returnSp)
+        {
+            lastAddress = c8.pc;
+            return STOP_STEP;
+        }
+
+        bool isTrue = checkConditions();
+        if(isTrue && !wasTrue)
+        {
+            lastAddress = c8.pc;
+            return STOP_CONDITION;
+        }
+        wasTrue = isTrue;
+    }
+
+    lastAddress = c8.pc;
+    return STOP_DONE;
+}
+
+STOP_t chip8Debugger::checkBefore(bool first)
+{
+    if(first)
+    {
+        return STOP_DONE;
+    }
+
+    unsigned short pc = c8.pc;
+    lastAddress = pc;
+    if(breakpoints[pc & (c8.memory.size() - 1)])
+    {
+        return STOP_BREAKPOINT;
+    }
+
+    ///< Decode the accesses the next opcode is about to make
+    chip8Access a = chip8Decoder(c8.quirks).next(c8);
+    if(rangeWatched(readWatch, a.read.start, a.read.length))
+    {
+        return STOP_WATCH_READ;
+    }
+    if(rangeWatched(writeWatch, a.write.start, a.write.length))
+    {
+        return STOP_WATCH_WRITE;
+    }
+
+    return STOP_DONE;
+}
+
+bool chip8Debugger::rangeWatched(const std::bitset<XO_MEMORY_SIZE> &watch, unsigned int start, unsigned int length)
+{
+    for(unsigned int i = 0; i < length; i++)
+    {
+        if(watch[(start + i) & (c8.memory.size() - 1)])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned short chip8Debugger::readRegister(int reg) const
+{
+    switch(reg)
+    {
+        case DBG_REG_I:  return c8.I;
+        case DBG_REG_PC: return c8.pc;
+        case DBG_REG_SP: return c8.sp;
+        case DBG_REG_DT: return c8.delay_timer;
+        case DBG_REG_ST: return c8.sound_timer;
+        default:         return c8.V[reg & 0xF];
+    }
+}
+
+bool chip8Debugger::checkConditions() const
+{
+    for(size_t i = 0; i < conditions.size(); i++)
+    {
+        unsigned short value = readRegister(conditions[i].reg);
+        bool hit = false;
+
+        switch(conditions[i].cmp)
+        {
+            case COND_EQ: hit = value == conditions[i].value; break;
+            case COND_NE: hit = value != conditions[i].value; break;
+            case COND_LT: hit = value <  conditions[i].value; break;
+            case COND_GT: hit = value >  conditions[i].value; break;
+            case COND_LE: hit = value <= conditions[i].value; break;
+            case COND_GE: hit = value >= conditions[i].value; break;
+        }
+        if(hit)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void chip8Debugger::printRegisters(FILE *out) const
+{
+    fprintf(out, "PC=%03X OP=%04X I=%04X SP=%X DT=%02X ST=%02X\n",
+            c8.pc, c8.fetchOpcode(), c8.I, c8.sp, c8.delay_timer, c8.sound_timer);
+    for(int i = 0; i < REGISTER_SIZE; i++)
+    {
+        fprintf(out, "V%X=%02X%s", i, c8.V[i], (i % 8 == 7) ? "\n" : " ");
+    }
+}
+
+void chip8Debugger::printMemory(FILE *out, unsigned short address, unsigned short length) const
+{
+    for(unsigned int i = 0; i < length; i++)
+    {
+        if(i % 16 == 0)
+        {
+            fprintf(out, "%s%03X:", i ? "\n" : "", (address + i) & (c8.memory.size() - 1));
+        }
+        fprintf(out, " %02X", c8.memory[(address + i) & (c8.memory.size() - 1)]);
+    }
+    fprintf(out, "\n");
+}
+
+////////////////////////////////////////////////////////////////////
+///< Console
+////////////////////////////////////////////////////////////////////
+static int parseRegister(const char *name)
+{
+    if((name[0] == 'V' || name[0] == 'v') && isxdigit((unsigned char)name[1]) && name[2] == '\0')
+    {
+        return (int)strtol(&name[1], NULL, 16);
+    }
+    if(!strcmp(name, "I"))  return DBG_REG_I;
+    if(!strcmp(name, "PC")) return DBG_REG_PC;
+    if(!strcmp(name, "SP")) return DBG_REG_SP;
+    if(!strcmp(name, "DT")) return DBG_REG_DT;
+    if(!strcmp(name, "ST")) return DBG_REG_ST;
+    return -1;
+}
+
+static int parseCompare(const char *op)
+{
+    static const char *ops[] = {"==", "!=", "<", ">", "<=", ">="};
+    for(int i = 0; i < 6; i++)
+    {
+        if(!strcmp(op, ops[i]))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool chip8Debugger::command(const char *line, FILE *out)
+{
+    char cmd[16] = "", arg1[16] = "", arg2[16] = "", arg3[16] = "";
+    int count = sscanf(line, "%15s %15s %15s %15s", cmd, arg1, arg2, arg3);
+    if(count <= 0)
+    {
+        return true;
+    }
+
+    unsigned long value1 = strtoul(arg1, NULL, 0);
+    STOP_t reason;
+
+    if(!strcmp(cmd, "q"))
+    {
+        return false;
+    }
+    else if(!strcmp(cmd, "b") && count > 1)
+    {
+        setBreakpoint(value1, true);
+        return true;
+    }
+    else if(!strcmp(cmd, "bd") && count > 1)
+    {
+        setBreakpoint(value1, false);
+        return true;
+    }
+    else if(!strcmp(cmd, "w") && count > 1)
+    {
+        const char *mode = (count > 2) ? arg2 : "rw";
+        setWatchpoint(value1, strchr(mode, 'r') != NULL, strchr(mode, 'w') != NULL);
+        return true;
+    }
+    else if(!strcmp(cmd, "wd") && count > 1)
+    {
+        setWatchpoint(value1, false, false);
+        return true;
+    }
+    else if(!strcmp(cmd, "cond") && count == 2 && !strcmp(arg1, "clear"))
+    {
+        clearConditions();
+        return true;
+    }
+    else if(!strcmp(cmd, "cond") && count == 4)
+    {
+        int reg = parseRegister(arg1);
+        int cmp = parseCompare(arg2);
+        if(reg < 0 || cmp < 0)
+        {
+            fprintf(out, "bad condition\n");
+            return true;
+        }
+        addCondition(reg, (COND_t)cmp, (unsigned short)strtoul(arg3, NULL, 0));
+        return true;
+    }
+    else if(!strcmp(cmd, "s"))
+    {
+        reason = step();
+    }
+    else if(!strcmp(cmd, "n"))
+    {
+        reason = stepOver(DBG_DEFAULT_CYCLES);
+    }
+    else if(!strcmp(cmd, "c"))
+    {
+        reason = run(count > 1 ? value1 : DBG_DEFAULT_CYCLES);
+    }
+    else if(!strcmp(cmd, "r"))
+    {
+        printRegisters(out);
+        return true;
+    }
+    else if(!strcmp(cmd, "m") && count > 1)
+    {
+        printMemory(out, value1, count > 2 ? (unsigned short)strtoul(arg2, NULL, 0) : 16);
+        return true;
+    }
+    else
+    {
+        fprintf(out, "commands: b|bd ADDR, w ADDR [r|w|rw], wd ADDR, cond REG OP VALUE, cond clear,\n"
+                     "          s, n, c [CYCLES], r, m ADDR [LEN], q\n");
+        return true;
+    }
+
+    fprintf(out, "stopped (%s) at %03X after %lu cycles\n", stopNames[reason], lastAddress, totalCycles);
+    printRegisters(out);
+    return true;
+}
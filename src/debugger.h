@@ -0,0 +1,89 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <stdio.h>
+#include <bitset>
+#include <vector>
+#include "chip8.h"
+
+///< Register condition targets beyond V0-VF
+#define DBG_REG_I       16
+#define DBG_REG_PC      17
+#define DBG_REG_SP      18
+#define DBG_REG_DT      19
+#define DBG_REG_ST      20
+
+typedef enum {
+    STOP_DONE,          ///< Cycle budget ran out
+    STOP_STEP,
+    STOP_BREAKPOINT,
+    STOP_WATCH_READ,
+    STOP_WATCH_WRITE,
+    STOP_CONDITION
+} STOP_t;
+
+typedef enum {
+    COND_EQ,
+    COND_NE,
+    COND_LT,
+    COND_GT,
+    COND_LE,
+    COND_GE
+} COND_t;
+
+/**
+ * Debugger driving a chip8 instance from the outside.
+ * The core has no hooks: memory accesses are found by decoding the next
+ * opcode before it runs. When nothing is armed run() uses a plain loop
+ * with no per cycle checks at all.
+ */
+class chip8Debugger
+{
+    public:
+        explicit chip8Debugger(chip8 &target);
+
+        void setBreakpoint(unsigned short address, bool enable);
+        void setWatchpoint(unsigned short address, bool onRead, bool onWrite);
+        void addCondition(int reg, COND_t cmp, unsigned short value);
+        void clearConditions();
+
+        ///< Run up to maxCycles instructions or until something triggers
+        STOP_t run(unsigned long maxCycles);
+        STOP_t step();
+        ///< Like step() but runs a 2NNN call through to its return
+        STOP_t stepOver(unsigned long maxCycles);
+
+        unsigned short stopAddress() const { return lastAddress; }
+        unsigned long cycles() const { return totalCycles; }
+
+        void printRegisters(FILE *out) const;
+        void printMemory(FILE *out, unsigned short address, unsigned short length) const;
+        ///< Parses and executes one console command, returns false on quit
+        bool command(const char *line, FILE *out);
+
+    private:
+        struct condition
+        {
+            int reg;
+            COND_t cmp;
+            unsigned short value;
+        };
+
+        chip8 &c8;
+        std::bitset<XO_MEMORY_SIZE> breakpoints;
+        std::bitset<XO_MEMORY_SIZE> readWatch;
+        std::bitset<XO_MEMORY_SIZE> writeWatch;
+        std::vector<condition> conditions;
+        unsigned long totalCycles;
+        unsigned short lastAddress;
+
+        bool armed() const;
+        STOP_t runFast(unsigned long maxCycles);
+        STOP_t runChecked(unsigned long maxCycles, bool untilReturn, unsigned short returnSp, bool checkFirst);
+        STOP_t checkBefore(bool first);
+        bool checkConditions() const;
+        unsigned short readRegister(int reg) const;
+        bool rangeWatched(const std::bitset<XO_MEMORY_SIZE> &watch, unsigned int start, unsigned int length);
+};
+
+#endif // DEBUGGER_H
@@ -0,0 +1,221 @@
+#include "explorer.h"
+
+#define FNV_OFFSET  0xcbf29ce484222325ULL
+#define FNV_PRIME   0x100000001b3ULL
+
+static unsigned int nextRandom(unsigned int &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+chip8Explorer::chip8Explorer(const chip8 &boot, const exploreConfig &config)
+    : config(config), published(0), seen(config.maxCells * 4),
+      pcSeen(new std::atomic<unsigned char>[XO_MEMORY_SIZE]), quit(false),
+      frames(0), bursts(0), pcs(0), dropped(0), maxDepth(0)
+{
+    if(this->config.numThreads <= 0)
+    {
+        this->config.numThreads = std::thread::hardware_concurrency();
+    }
+    if(this->config.maxCells < 1)
+    {
+        this->config.maxCells = 1;
+    }
+    for(int i = 0; i < XO_MEMORY_SIZE; i++)
+    {
+        pcSeen[i].store(0, std::memory_order_relaxed);
+    }
+
+    cells.reset(new std::unique_ptr<cell>[this->config.maxCells]);
+    seen.insert(cellKey(boot));
+    addCell(boot, 0);
+    started = stopped = clock::now();
+}
+
+chip8Explorer::~chip8Explorer()
+{
+    stop();
+}
+
+void chip8Explorer::start()
+{
+    quit.store(false);
+    started = clock::now();
+    for(int i = 0; i < config.numThreads; i++)
+    {
+        workers.push_back(std::thread(&chip8Explorer::workerLoop, this, i));
+    }
+}
+
+void chip8Explorer::stop()
+{
+    if(workers.empty())
+    {
+        return;
+    }
+    quit.store(true);
+    for(size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    workers.clear();
+    stopped = clock::now();
+}
+
+exploreStats chip8Explorer::stats() const
+{
+    exploreStats s;
+    clock::time_point end = workers.empty() ? stopped : clock::now();
+    s.seconds = std::chrono::duration<double>(end - started).count();
+    s.cells = published.load(std::memory_order_acquire);
+    s.dropped = dropped.load(std::memory_order_relaxed);
+    s.frames = frames.load(std::memory_order_relaxed);
+    s.bursts = bursts.load(std::memory_order_relaxed);
+    s.pcs = pcs.load(std::memory_order_relaxed);
+    s.maxDepth = maxDepth.load(std::memory_order_relaxed);
+    return s;
+}
+
+void chip8Explorer::workerLoop(int thread)
+{
+    unsigned int rng = (config.seed + 1) * 2654435761u + thread * 40503u;
+    if(rng == 0)
+    {
+        rng = 1;
+    }
+
+    ///< Without restore every worker plays one long game from boot
+    chip8 c8 = cells[0]->c8;
+    unsigned long depth = 0;
+
+    while(!quit.load(std::memory_order_relaxed))
+    {
+        if(config.restore)
+        {
+            cell &from = selectCell(rng);
+            from.chosen.fetch_add(1, std::memory_order_relaxed);
+            c8 = from.c8;
+            depth = from.depth;
+        }
+
+        int key = -1;
+        int hold = 0;
+        for(int f = 0; f < config.burstFrames; f++)
+        {
+            ///< Random key or no key, held for a random number of frames
+            if(hold == 0)
+            {
+                key = (int)(nextRandom(rng) % (KEYPAD_SIZE + 1)) - 1;
+                hold = 1 + (int)(nextRandom(rng) % config.holdFrames);
+            }
+            hold--;
+            for(int k = 0; k < KEYPAD_SIZE; k++)
+            {
+                c8.key[k] = (k == key);
+            }
+
+            c8.emulateFrame(config.cyclesPerFrame);
+            depth++;
+            markPc(c8.getPc());
+
+            ///< A full set reports everything as new, only trust it while nothing overflowed
+            if(seen.insert(cellKey(c8)) && seen.dropped() == 0)
+            {
+                addCell(c8, depth);
+            }
+        }
+
+        frames.fetch_add(config.burstFrames, std::memory_order_relaxed);
+        bursts.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+unsigned long long chip8Explorer::cellKey(const chip8 &c8) const
+{
+    int blockWidth = GFX_WIDTH / config.gridWidth;
+    int blockHeight = GFX_HEIGHT / config.gridHeight;
+    int blockPixels = blockWidth * blockHeight;
+    unsigned long long hash = FNV_OFFSET;
+
+    ///< Pixels lit per block, quantized to a few levels
+    for(int gy = 0; gy < config.gridHeight; gy++)
+    {
+        int lit[GFX_WIDTH] = {0};
+        for(int y = gy * blockHeight; y < (gy + 1) * blockHeight; y++)
+        {
+            unsigned long long row = c8.loresRow(y);
+            for(int gx = 0; gx < config.gridWidth; gx++)
+            {
+                unsigned long long bits = (row << (gx * blockWidth)) >> (64 - blockWidth);
+                lit[gx] += __builtin_popcountll(bits);
+            }
+        }
+        for(int gx = 0; gx < config.gridWidth; gx++)
+        {
+            int level = (lit[gx] * (config.levels - 1) + blockPixels - 1) / blockPixels;
+            hash = (hash ^ (unsigned long long)level) * FNV_PRIME;
+        }
+    }
+
+    ///< Waits on the delay timer leave the display alone, the coarse timer keeps them moving
+    hash = (hash ^ (c8.delay_timer >> 4)) * FNV_PRIME;
+
+    for(size_t i = 0; i < config.addresses.size(); i++)
+    {
+        hash = (hash ^ c8.memory[config.addresses[i]]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+chip8Explorer::cell &chip8Explorer::selectCell(unsigned int &rng)
+{
+    ///< Every published slot holds a complete cell and is never written again
+    size_t count = published.load(std::memory_order_acquire);
+    cell *best = cells[nextRandom(rng) % count].get();
+    for(int i = 1; i < EXPLORE_CANDIDATES; i++)
+    {
+        cell *candidate = cells[nextRandom(rng) % count].get();
+        if(candidate->chosen.load(std::memory_order_relaxed) < best->chosen.load(std::memory_order_relaxed))
+        {
+            best = candidate;
+        }
+    }
+    return *best;
+}
+
+void chip8Explorer::addCell(const chip8 &c8, unsigned long depth)
+{
+    std::unique_ptr<cell> c(new cell);
+    c->c8 = c8;
+    c->depth = depth;
+    c->chosen.store(0, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> guard(addLock);
+        size_t count = published.load(std::memory_order_relaxed);
+        if(count >= config.maxCells)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        cells[count] = std::move(c);
+        published.store(count + 1, std::memory_order_release);
+    }
+
+    unsigned long deepest = maxDepth.load(std::memory_order_relaxed);
+    while(depth > deepest && !maxDepth.compare_exchange_weak(deepest, depth, std::memory_order_relaxed))
+    {
+    }
+}
+
+void chip8Explorer::markPc(unsigned short pc)
+{
+    std::atomic<unsigned char> &slot = pcSeen[pc];
+    if(slot.load(std::memory_order_relaxed) == 0 && slot.exchange(1, std::memory_order_relaxed) == 0)
+    {
+        pcs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
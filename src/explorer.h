@@ -0,0 +1,114 @@
+#ifndef EXPLORER_H
+#define EXPLORER_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+#include "stateset.h"
+
+#define EXPLORE_CYCLES_PER_FRAME    10
+#define EXPLORE_BURST_FRAMES        30
+#define EXPLORE_HOLD_FRAMES         8
+#define EXPLORE_GRID_WIDTH          16
+#define EXPLORE_GRID_HEIGHT         8
+#define EXPLORE_LEVELS              4
+#define EXPLORE_MAX_CELLS           65536
+///< Cells compared when picking one to restore, the least chosen wins
+#define EXPLORE_CANDIDATES          4
+
+struct exploreConfig
+{
+    int numThreads;             ///< <= 0 uses every hardware thread
+    int cyclesPerFrame;
+    int burstFrames;            ///< Frames of random input played from each restored cell
+    int holdFrames;             ///< Longest a random key is held
+    int gridWidth;              ///< Display downsample the cell key is built from
+    int gridHeight;
+    int levels;                 ///< Brightness levels per downsampled block
+    size_t maxCells;            ///< Archive capacity, new cells past it are counted and dropped
+    bool restore;               ///< false plays on from boot without restoring, the random play baseline
+    unsigned int seed;
+    std::vector<unsigned short> addresses;  ///< Memory bytes added to the cell key, e.g. level or score
+
+    exploreConfig()
+        : numThreads(0), cyclesPerFrame(EXPLORE_CYCLES_PER_FRAME), burstFrames(EXPLORE_BURST_FRAMES),
+          holdFrames(EXPLORE_HOLD_FRAMES), gridWidth(EXPLORE_GRID_WIDTH), gridHeight(EXPLORE_GRID_HEIGHT),
+          levels(EXPLORE_LEVELS), maxCells(EXPLORE_MAX_CELLS), restore(true), seed(1) {}
+};
+
+struct exploreStats
+{
+    double seconds;
+    unsigned long cells;        ///< Cells in the archive
+    unsigned long dropped;      ///< New cells found after the archive was full
+    unsigned long frames;
+    unsigned long bursts;
+    unsigned long pcs;          ///< Distinct program counters seen at frame ends
+    unsigned long maxDepth;     ///< Most frames from boot to any archived cell
+};
+
+/**
+ * Go-Explore style state space search. A cell is a coarse downsample of the
+ * display, the delay timer's top bits and a few chosen memory bytes; the
+ * archive keeps the first snapshot that reached each cell. Workers
+ * repeatedly pick a rarely chosen cell, restore it, play a burst of random
+ * keys and archive every cell they reach for the first time. The archive is
+ * a fixed array of slots filled in order: cells are published through an
+ * atomic count so picking one takes no lock, and first sight of a cell is
+ * decided by the lock free stateSet.
+ */
+class chip8Explorer
+{
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        ///< boot is the loaded machine the search starts from
+        chip8Explorer(const chip8 &boot, const exploreConfig &config = exploreConfig());
+        ~chip8Explorer();
+
+        void start();
+        void stop();
+
+        exploreStats stats() const;
+        ///< Archived cell snapshots, index 0 is boot. Valid while the explorer lives
+        size_t size() const { return published.load(std::memory_order_acquire); }
+        const chip8 &snapshot(size_t index) const { return cells[index]->c8; }
+        unsigned long depth(size_t index) const { return cells[index]->depth; }
+
+    private:
+        struct cell
+        {
+            chip8 c8;
+            unsigned long depth;            ///< Frames from boot
+            std::atomic<unsigned long> chosen;
+        };
+
+        exploreConfig config;
+        std::unique_ptr<std::unique_ptr<cell>[]> cells;     ///< maxCells slots, the first published are filled
+        std::atomic<size_t> published;
+        std::mutex addLock;
+        stateSet seen;
+        std::unique_ptr<std::atomic<unsigned char>[]> pcSeen;
+
+        std::vector<std::thread> workers;
+        std::atomic<bool> quit;
+        clock::time_point started;
+        clock::time_point stopped;
+        std::atomic<unsigned long> frames;
+        std::atomic<unsigned long> bursts;
+        std::atomic<unsigned long> pcs;
+        std::atomic<unsigned long> dropped;
+        std::atomic<unsigned long> maxDepth;
+
+        void workerLoop(int thread);
+        unsigned long long cellKey(const chip8 &c8) const;
+        cell &selectCell(unsigned int &rng);
+        void addCell(const chip8 &c8, unsigned long depth);
+        void markPc(unsigned short pc);
+};
+
+#endif // EXPLORER_H
@@ -1,9 +1,17 @@
 #include <iostream>
 #include <GL/glut.h>
 #include "chip8.h"
+#include "shmexport.h"
+#include "spectator.h"
+#include "pacer.h"
+#include "romdb.h"
+#include "startup.h"
 #include <GL/glu.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <chrono>
+#include <thread>
 
 #define MAX_FILENAME_SIZE	100
 
@@ -11,14 +19,46 @@
 #define SCREEN_WIDTH 64
 #define SCREEN_HEIGHT 32
 
+// Defined first so it starts timing before the other globals are built
+startupTimer startup;
+
 chip8 myChip8;
 int modifier = 10;
 
+// Every mode runs whole frames of cyclesPerFrame instructions, woken at 60Hz by the pacer
+#define REPORT_FRAMES		60
+int cyclesPerFrame = ROMDB_CYCLES_PER_FRAME;
+framePacer pacer;
+
+// ROM settings, from roms/roms.db (or CHIP8_ROMDB) when the ROM is in it
+romDatabase romDb;
+romImage image;
+char keymap[KEYPAD_SIZE];
+
+// Run-ahead: frames emulated past the real state before drawing, 0 is off
+int runAhead = 0;
+chip8 aheadChip8;
+
+// Shared memory export of every finished frame, on when CHIP8_EXPORT names a segment
+shmExporter exporter;
+unsigned long long instructionCount = 0;
+unsigned long long droppedFrames = 0;
+
+// Spectators: CHIP8_STREAM names a socket to broadcast on, -watch shows someone else's session
+spectatorServer streamer;
+spectatorClient spectator;
+
 // Window size
 int display_width = SCREEN_WIDTH * modifier;
 int display_height = SCREEN_HEIGHT * modifier;
 
+bool parseRunArgs(int argc, char **argv, QUIRKS_t &quirks, TIMING_t &timing, int &count);
+bool loadMachine(const char *romName, QUIRKS_t quirks, TIMING_t timing);
+int runHeadless(int argc, char **argv);
 void display();
+void displayRunAhead();
+void displayWatch();
+void setupWindow(int *argc, char **argv, void (*callback)());
 void reshape_window(GLsizei w, GLsizei h);
 void keyboardUp(unsigned char key, int x, int y);
 void keyboardDown(unsigned char key, int x, int y);
@@ -26,8 +66,16 @@ void keyboardDown(unsigned char key, int x, int y);
 // Use new drawing method
 // #define DRAWWITHTEXTURE
 
-typedef unsigned int u8;
-u8 screenData[SCREEN_HEIGHT][SCREEN_WIDTH][3]; 
+// XO-CHIP colours: off, plane 1, plane 2, both planes
+const float palette[4][3] = {
+	{0.0f, 0.0f, 0.0f},
+	{1.0f, 1.0f, 1.0f},
+	{1.0f, 0.6f, 0.0f},
+	{0.4f, 0.4f, 0.4f}
+};
+
+typedef unsigned char u8;
+u8 screenData[HIRES_HEIGHT][HIRES_WIDTH][3]; 
 void setupTexture();
 
 
@@ -35,56 +83,151 @@ int main(int argc, char** argv) {
 
 	char romName[MAX_FILENAME_SIZE];
 
-	if (argc > 1)
+	if (argc > 1 && !strcmp(argv[1], "-watch"))
+	{
+		const char *socketPath = (argc > 2) ? argv[2] : SPECTATOR_PATH;
+		if(!spectator.connect(socketPath))
+		{
+			printf("Cannot connect to %s\n", socketPath);
+			return 1;
+		}
+		setupWindow(&argc, argv, displayWatch);
+		glutMainLoop();
+	}
+	else if (argc > 2 && !strcmp(argv[1], "-headless"))
+	{
+		return runHeadless(argc - 1, argv + 1);
+	}
+	else if (argc > 1)
 	{
 		strcpy(romName, argv[1]);
 
-		///< Load game
-		if(!myChip8.loadGame(romName))
+		///< Last argument shows the machine this many frames ahead of the input
+		QUIRKS_t quirks;
+		TIMING_t timing;
+		if(!parseRunArgs(argc, argv, quirks, timing, runAhead))
 		{
 			return 1;
-		}	
-			
-		///< Setup OpenGL
-		glutInit(&argc, (char **)argv);          
-		glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);
-
-		glutInitWindowSize(display_width, display_height);
-		glutInitWindowPosition(320, 320);
-		glutCreateWindow("myChip8");
-		
-		glutDisplayFunc(display);
-		glutIdleFunc(display);
-		glutReshapeFunc(reshape_window);        
-		glutKeyboardFunc(keyboardDown);
-		glutKeyboardUpFunc(keyboardUp);
-
-		#ifdef DRAWWITHTEXTURE
-		setupTexture();			
-		#endif	
+		}
 
+		///< The ROM loads on another thread while the window comes up, GLUT stays on this one
+		bool loaded = false;
+		std::thread loader([&]() { loaded = loadMachine(romName, quirks, timing); });
+		setupWindow(&argc, argv, runAhead > 0 ? displayRunAhead : display);
+		startup.mark(STARTUP_DISPLAY_READY);
+		loader.join();
+		if(!loaded)
+		{
+			return 1;
+		}
 		glutMainLoop(); 
 	}
 	else
 	{
 		printf("Missing input arguments\n");
-		printf("Usage: ./chip8Emulator <Rom Name>\n");
+		printf("Usage: ./chip8Emulator <Rom Name> [database|modern|vip|chip48|schip|xochip] [fixed|vip] [run-ahead frames]\n");
+		printf("       ./chip8Emulator -headless <Rom Name> [profile] [fixed|vip] [frames]\n");
+		printf("       ./chip8Emulator -watch [socket]\n");
 	}
 
 	return 1;
 }
 
+// Arguments after the ROM name: [profile] [fixed|vip] [count]
+bool parseRunArgs(int argc, char **argv, QUIRKS_t &quirks, TIMING_t &timing, int &count)
+{
+	///< No profile argument takes the one from the database
+	quirks = NUM_QUIRKS;
+	if(argc > 2 && strcmp(argv[2], "database"))
+	{
+		quirks = quirksFromName(argv[2]);
+		if(quirks == NUM_QUIRKS)
+		{
+			printf("Unknown quirk profile: %s\n", argv[2]);
+			return false;
+		}
+	}
+
+	///< Charge COSMAC VIP machine cycles per instruction instead of one each
+	timing = TIMING_FIXED;
+	if(argc > 3 && !strcmp(argv[3], "vip"))
+	{
+		timing = TIMING_VIP;
+	}
+
+	count = (argc > 4) ? atoi(argv[4]) : 0;
+	return true;
+}
+
+// Loads and boots the ROM and opens the exporters, touches nothing of GLUT
+bool loadMachine(const char *romName, QUIRKS_t quirks, TIMING_t timing)
+{
+	const char *dbPath = getenv("CHIP8_ROMDB");
+	romDb.load(dbPath != NULL ? dbPath : ROMDB_PATH);
+	if(!image.loadFile(romName, &romDb, quirks))
+	{
+		printf("Cannot load %s\n", romName);
+		return false;
+	}
+	const romInfo &info = image.info();
+	printf("Loading: %s (%s)\n", image.known() ? info.name.c_str() : romName,
+	       image.known() ? "in database" : "unknown ROM");
+	printf("Profile: %s, %d cycles per frame, hash %016llx\n",
+	       quirksName(info.quirks), info.cyclesPerFrame, info.hash);
+	cyclesPerFrame = info.cyclesPerFrame;
+	memcpy(keymap, info.keymap, KEYPAD_SIZE);
+
+	image.reset(myChip8);
+	myChip8.setTiming(timing);
+	startup.mark(STARTUP_ROM_LOADED);
+
+	const char *exportName = getenv("CHIP8_EXPORT");
+	if(exportName != NULL && !exporter.open(exportName))
+	{
+		return false;
+	}
+
+	const char *streamPath = getenv("CHIP8_STREAM");
+	if(streamPath != NULL && !streamer.open(streamPath))
+	{
+		return false;
+	}
+	return true;
+}
+
+void setupWindow(int *argc, char **argv, void (*callback)())
+{
+	///< Setup OpenGL
+	glutInit(argc, argv);
+	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);
+
+	glutInitWindowSize(display_width, display_height);
+	glutInitWindowPosition(320, 320);
+	glutCreateWindow("myChip8");
+
+	glutDisplayFunc(callback);
+	// The callbacks sleep in the pacer until the next frame, so idling does not spin
+	glutIdleFunc(callback);
+	glutReshapeFunc(reshape_window);
+	glutKeyboardFunc(keyboardDown);
+	glutKeyboardUpFunc(keyboardUp);
+
+	#ifdef DRAWWITHTEXTURE
+	setupTexture();
+	#endif
+}
 
 // Setup Texture
 void setupTexture()
 {
 	// Clear screen
-	for(int y = 0; y < SCREEN_HEIGHT; ++y)		
-		for(int x = 0; x < SCREEN_WIDTH; ++x)
+	for(int y = 0; y < HIRES_HEIGHT; ++y)		
+		for(int x = 0; x < HIRES_WIDTH; ++x)
 			screenData[y][x][0] = screenData[y][x][1] = screenData[y][x][2] = 0;
 
-	// Create a texture 
-	glTexImage2D(GL_TEXTURE_2D, 0, 3, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)screenData);
+	// Create a texture big enough for hires, lores only uses the top left corner
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, 3, HIRES_WIDTH, HIRES_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)screenData);
 
 	// Set up the texture
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -96,59 +239,106 @@ void setupTexture()
 	glEnable(GL_TEXTURE_2D);
 }
 
-void updateTexture(const chip8& c8)
+// Drawing works on anything with displayWidth(), displayHeight() and pixel(x, y)
+template <class Display>
+void renderScreen(const Display& c8)
+{
+	for(int y = 0; y < c8.displayHeight(); ++y)		
+		for(int x = 0; x < c8.displayWidth(); ++x)
+		{
+			const float *colour = palette[c8.pixel(x, y)];
+			screenData[y][x][0] = (u8)(colour[0] * 255);
+			screenData[y][x][1] = (u8)(colour[1] * 255);
+			screenData[y][x][2] = (u8)(colour[2] * 255);
+		}
+}
+
+template <class Display>
+void updateTexture(const Display& c8)
 {	
+	int width = c8.displayWidth();
+	int height = c8.displayHeight();
+
 	// Update pixels
-	for(int y = 0; y < 32; ++y)		
-		for(int x = 0; x < 64; ++x)
-			if(c8.gfx[(y * 64) + x] == 0)
-				screenData[y][x][0] = screenData[y][x][1] = screenData[y][x][2] = 0;	// Disabled
-			else 
-				screenData[y][x][0] = screenData[y][x][1] = screenData[y][x][2] = 255;  // Enabled
+	renderScreen(c8);
 		
 	// Update Texture
-	glTexSubImage2D(GL_TEXTURE_2D, 0 ,0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)screenData);
+	glTexSubImage2D(GL_TEXTURE_2D, 0 ,0, 0, HIRES_WIDTH, HIRES_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)screenData);
 
+	double u = (double)width / HIRES_WIDTH;
+	double v = (double)height / HIRES_HEIGHT;
 	glBegin( GL_QUADS );
 		glTexCoord2d(0.0, 0.0);		glVertex2d(0.0,			  0.0);
-		glTexCoord2d(1.0, 0.0); 	glVertex2d(display_width, 0.0);
-		glTexCoord2d(1.0, 1.0); 	glVertex2d(display_width, display_height);
-		glTexCoord2d(0.0, 1.0); 	glVertex2d(0.0,			  display_height);
+		glTexCoord2d(u, 0.0); 		glVertex2d(display_width, 0.0);
+		glTexCoord2d(u, v); 		glVertex2d(display_width, display_height);
+		glTexCoord2d(0.0, v); 		glVertex2d(0.0,			  display_height);
 	glEnd();
 }
 
 // Old gfx code
-void drawPixel(int x, int y)
+void drawPixel(int x, int y, float size)
 {
 	glBegin(GL_QUADS);
-		glVertex3f((x * modifier) + 0.0f,     (y * modifier) + 0.0f,	 0.0f);
-		glVertex3f((x * modifier) + 0.0f,     (y * modifier) + modifier, 0.0f);
-		glVertex3f((x * modifier) + modifier, (y * modifier) + modifier, 0.0f);
-		glVertex3f((x * modifier) + modifier, (y * modifier) + 0.0f,	 0.0f);
+		glVertex3f((x * size) + 0.0f, (y * size) + 0.0f, 0.0f);
+		glVertex3f((x * size) + 0.0f, (y * size) + size, 0.0f);
+		glVertex3f((x * size) + size, (y * size) + size, 0.0f);
+		glVertex3f((x * size) + size, (y * size) + 0.0f, 0.0f);
 	glEnd();
 }
 
-void updateQuads(const chip8& c8)
+template <class Display>
+void updateQuads(const Display& c8)
 {
+	// Hires pixels are half the size so the window keeps its size
+	float size = (float)modifier * SCREEN_WIDTH / c8.displayWidth();
+
 	// Draw
-	for(int y = 0; y < 32; ++y)		
-		for(int x = 0; x < 64; ++x)
+	for(int y = 0; y < c8.displayHeight(); ++y)		
+		for(int x = 0; x < c8.displayWidth(); ++x)
 		{
-			if(c8.gfx[(y*64) + x] == 0) 
-				glColor3f(0.0f,0.0f,0.0f);			
-			else 
-				glColor3f(1.0f,1.0f,1.0f);
+			glColor3fv(palette[c8.pixel(x, y)]);
 
-			drawPixel(x, y);
+			drawPixel(x, y, size);
 		}
 }
 
+// Publishes the real machine state, no allocation and no system calls
+void exportFrame(const chip8& c8)
+{
+	typedef std::chrono::steady_clock clock;
+	static clock::time_point last = clock::now();
+	static unsigned long long lastCount = 0;
+
+	if(!exporter.isOpen())
+	{
+		return;
+	}
+
+	clock::time_point now = clock::now();
+	double us = std::chrono::duration<double, std::micro>(now - last).count();
+	shmCounters counters;
+	counters.frameTimeUs = us;
+	counters.instructionsPerSec = (us > 0) ? (instructionCount - lastCount) * 1e6 / us : 0;
+	counters.droppedFrames = droppedFrames;
+	exporter.publish(c8, counters);
+
+	last = now;
+	lastCount = instructionCount;
+}
+
 void display()
 {
-	myChip8.emulateCycle();
+	droppedFrames += pacer.wait();
+	startup.mark(STARTUP_FIRST_INSTRUCTION);
+	myChip8.emulateFrame(cyclesPerFrame);
+	instructionCount += cyclesPerFrame;
+	// Every finished frame is exported, the ring's counters move on frames that draw nothing too
+	exportFrame(myChip8);
 		
 	if(myChip8.drawFlag)
 	{
+		streamer.broadcast(myChip8);
+
 		// Clear framebuffer
 		glClear(GL_COLOR_BUFFER_BIT);
         
@@ -160,12 +350,113 @@ void display()
 
 		// Swap buffers!
 		glutSwapBuffers();    
+		startup.mark(STARTUP_FIRST_FRAME);
 
 		// Processed frame
 		myChip8.drawFlag = false;
 	}
 }
 
+template <class Display>
+void drawMachine(const Display& c8)
+{
+	glClear(GL_COLOR_BUFFER_BIT);
+#ifdef DRAWWITHTEXTURE
+	updateTexture(c8);
+#else
+	updateQuads(c8);
+#endif
+	glutSwapBuffers();
+	startup.mark(STARTUP_FIRST_FRAME);
+}
+
+// Runs whole 60Hz frames and draws the state runAhead frames in the future
+void displayRunAhead()
+{
+	typedef std::chrono::steady_clock clock;
+	static long long frameUs = 0, aheadUs = 0;
+	static int frames = 0;
+
+	droppedFrames += pacer.wait();
+	startup.mark(STARTUP_FIRST_INSTRUCTION);
+	clock::time_point start = clock::now();
+
+	myChip8.emulateFrame(cyclesPerFrame);
+	instructionCount += cyclesPerFrame;
+	exportFrame(myChip8);
+	streamer.broadcast(myChip8);
+	clock::time_point emulated = clock::now();
+
+	// Snapshot, run ahead with the current keys, show that, and the real state carries on
+	aheadChip8 = myChip8;
+	aheadChip8.setVerbose(false);
+	for(int i = 0; i < runAhead; i++)
+	{
+		aheadChip8.emulateFrame(cyclesPerFrame);
+	}
+	clock::time_point ahead = clock::now();
+
+	drawMachine(aheadChip8);
+	myChip8.drawFlag = false;
+
+	frameUs += std::chrono::duration_cast<std::chrono::microseconds>(emulated - start).count();
+	aheadUs += std::chrono::duration_cast<std::chrono::microseconds>(ahead - emulated).count();
+	if(++frames == REPORT_FRAMES)
+	{
+		printf("Run-ahead %d: frame %.1f us, run-ahead overhead %.1f us per frame\n",
+		       runAhead, (double)frameUs / frames, (double)aheadUs / frames);
+		frameUs = aheadUs = frames = 0;
+	}
+}
+// Headless: no window and no pacing, frames run back to back and are rendered into screenData
+int runHeadless(int argc, char **argv)
+{
+	QUIRKS_t quirks;
+	TIMING_t timing;
+	int frames;
+	if(!parseRunArgs(argc, argv, quirks, timing, frames) || !loadMachine(argv[1], quirks, timing))
+	{
+		return 1;
+	}
+	if(frames <= 0)
+	{
+		frames = 1;
+	}
+
+	for(int f = 0; f < frames; f++)
+	{
+		startup.mark(STARTUP_FIRST_INSTRUCTION);
+		myChip8.emulateFrame(cyclesPerFrame);
+		instructionCount += cyclesPerFrame;
+		exportFrame(myChip8);
+		if(myChip8.drawFlag)
+		{
+			streamer.broadcast(myChip8);
+			myChip8.drawFlag = false;
+		}
+		renderScreen(myChip8);
+		startup.mark(STARTUP_FIRST_FRAME);
+	}
+
+	printf("%d frames, state hash %016llx\n", frames, myChip8.stateHash());
+	return 0;
+}
+
+// Spectator mode, draws whatever the streaming session sent
+void displayWatch()
+{
+	pacer.wait();
+	int frames = spectator.poll();
+	if(frames < 0)
+	{
+		printf("Stream closed\n");
+		exit(0);
+	}
+	if(frames > 0)
+	{
+		drawMachine(spectator);
+	}
+}
 
 void reshape_window(GLsizei w, GLsizei h)
 {
@@ -186,48 +477,16 @@ void keyboardDown(unsigned char key, int x, int y)
 	if(key == 27)    // esc
 		exit(0);
 
-	if(key == '1')		myChip8.key[0x1] = 1;
-	else if(key == '2')	myChip8.key[0x2] = 1;
-	else if(key == '3')	myChip8.key[0x3] = 1;
-	else if(key == '4')	myChip8.key[0xC] = 1;
-
-	else if(key == 'q')	myChip8.key[0x4] = 1;
-	else if(key == 'w')	myChip8.key[0x5] = 1;
-	else if(key == 'e')	myChip8.key[0x6] = 1;
-	else if(key == 'r')	myChip8.key[0xD] = 1;
-
-	else if(key == 'a')	myChip8.key[0x7] = 1;
-	else if(key == 's')	myChip8.key[0x8] = 1;
-	else if(key == 'd')	myChip8.key[0x9] = 1;
-	else if(key == 'f')	myChip8.key[0xE] = 1;
-
-	else if(key == 'z')	myChip8.key[0xA] = 1;
-	else if(key == 'x')	myChip8.key[0x0] = 1;
-	else if(key == 'c')	myChip8.key[0xB] = 1;
-	else if(key == 'v')	myChip8.key[0xF] = 1;
+	for(int i = 0; i < KEYPAD_SIZE; ++i)
+		if(key == keymap[i])
+			myChip8.key[i] = 1;
 
 	//printf("Press key %c\n", key);
 }
 
 void keyboardUp(unsigned char key, int x, int y)
 {
-	if(key == '1')		myChip8.key[0x1] = 0;
-	else if(key == '2')	myChip8.key[0x2] = 0;
-	else if(key == '3')	myChip8.key[0x3] = 0;
-	else if(key == '4')	myChip8.key[0xC] = 0;
-
-	else if(key == 'q')	myChip8.key[0x4] = 0;
-	else if(key == 'w')	myChip8.key[0x5] = 0;
-	else if(key == 'e')	myChip8.key[0x6] = 0;
-	else if(key == 'r')	myChip8.key[0xD] = 0;
-
-	else if(key == 'a')	myChip8.key[0x7] = 0;
-	else if(key == 's')	myChip8.key[0x8] = 0;
-	else if(key == 'd')	myChip8.key[0x9] = 0;
-	else if(key == 'f')	myChip8.key[0xE] = 0;
-
-	else if(key == 'z')	myChip8.key[0xA] = 0;
-	else if(key == 'x')	myChip8.key[0x0] = 0;
-	else if(key == 'c')	myChip8.key[0xB] = 0;
-	else if(key == 'v')	myChip8.key[0xF] = 0;
+	for(int i = 0; i < KEYPAD_SIZE; ++i)
+		if(key == keymap[i])
+			myChip8.key[i] = 0;
 }
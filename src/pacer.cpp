@@ -0,0 +1,76 @@
+#include <errno.h>
+#include <algorithm>
+#include "pacer.h"
+
+#define NS_PER_SEC  1000000000LL
+
+static long long monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+framePacer::framePacer(long long periodNs, FILE *out)
+    : period(periodNs), next(0), lastWake(0), maxLate(0), skipped(0), skippedReported(0), out(out), count(0)
+{
+}
+
+int framePacer::wait()
+{
+    long long now = monotonicNs();
+    int missed = 0;
+
+    ///< The first frame runs straight away, the schedule starts from it
+    if(next == 0)
+    {
+        next = now;
+        lastWake = now;
+        return 0;
+    }
+    next += period;
+    if(now > next + period)
+    {
+        ///< Drop the boundaries we slept through rather than bursting to catch up
+        missed = (int)((now - next) / period);
+        next += missed * period;
+        skipped += missed;
+    }
+
+    struct timespec deadline;
+    deadline.tv_sec = next / NS_PER_SEC;
+    deadline.tv_nsec = next % NS_PER_SEC;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+    {
+    }
+
+    long long woke = monotonicNs();
+    samples[count++] = woke - lastWake;
+    lastWake = woke;
+    maxLate = std::max(maxLate, woke - next);
+
+    if(count == PACER_REPORT_FRAMES)
+    {
+        report();
+        count = 0;
+    }
+    return missed;
+}
+
+void framePacer::report()
+{
+    if(out == NULL)
+    {
+        return;
+    }
+
+    std::nth_element(samples, samples + count / 2, samples + count);
+    long long p50 = samples[count / 2];
+    std::nth_element(samples, samples + count * 99 / 100, samples + count);
+    long long p99 = samples[count * 99 / 100];
+
+    fprintf(out, "Frame pacing: p50 %.3f ms, p99 %.3f ms, worst wakeup %.0f us late, %llu frames skipped\n",
+            p50 / 1e6, p99 / 1e6, maxLate / 1e3, skipped - skippedReported);
+    skippedReported = skipped;
+    maxLate = 0;
+}
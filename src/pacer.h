@@ -0,0 +1,43 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdio.h>
+#include <time.h>
+
+#define PACER_FRAME_NS          16666667LL
+///< Frames between two jitter reports
+#define PACER_REPORT_FRAMES     600
+
+/**
+ * Sleeps until absolute frame boundaries on CLOCK_MONOTONIC with
+ * clock_nanosleep, so there is one wakeup per frame and no drift. Falling
+ * more than a frame behind skips the missed boundaries instead of running
+ * them back to back. Wakeup intervals are sampled into a fixed buffer and
+ * their p50/p99 are printed every PACER_REPORT_FRAMES frames.
+ */
+class framePacer
+{
+    public:
+        ///< out may be NULL to keep the statistics quiet
+        explicit framePacer(long long periodNs = PACER_FRAME_NS, FILE *out = stdout);
+
+        ///< Returns the number of frame boundaries that were skipped, 0 when on time
+        int wait();
+
+        unsigned long long overruns() const { return skipped; }
+
+    private:
+        long long period;
+        long long next;
+        long long lastWake;
+        long long maxLate;
+        unsigned long long skipped;
+        unsigned long long skippedReported;
+        FILE *out;
+        int count;
+        long long samples[PACER_REPORT_FRAMES];
+
+        void report();
+};
+
+#endif // PACER_H
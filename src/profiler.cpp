@@ -0,0 +1,223 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "profiler.h"
+
+#define HOTTEST_COUNT   16
+
+chip8Profiler::chip8Profiler(chip8 &target)
+    : c8(target), profile(target.quirks), decoder(target.quirks)
+{
+    clear();
+}
+
+void chip8Profiler::clear()
+{
+    mask = c8.memory.size() - 1;
+    for(int a = 0; a < NUM_ACCESSES; a++)
+    {
+        counts[a].assign(c8.memory.size(), 0);
+    }
+    memset(opcodes, 0, sizeof(opcodes));
+    totalInstructions = 0;
+    profile = c8.quirks;
+    decoder = chip8Decoder(profile);
+}
+
+void chip8Profiler::runFrame(int cycles)
+{
+    ///< The ROM may have been reloaded with another profile since the last frame
+    if(c8.quirks != profile || c8.memory.size() - 1 != mask)
+    {
+        clear();
+    }
+
+    for(int i = 0; i < cycles; i++)
+    {
+        observe();
+        c8.execute(c8, 1);
+    }
+    c8.updateTimers();
+}
+
+void chip8Profiler::observe()
+{
+    chip8Access a = decoder.next(c8);
+
+    opcodes[a.op + 1]++;
+    totalInstructions++;
+    counts[ACCESS_EXECUTE][c8.pc & mask]++;
+    countRange(ACCESS_READ, a.read.start, a.read.length);
+    countRange(ACCESS_WRITE, a.write.start, a.write.length);
+}
+
+void chip8Profiler::countRange(ACCESS_t access, unsigned int start, unsigned int length)
+{
+    for(unsigned int i = 0; i < length; i++)
+    {
+        counts[access][(start + i) & mask]++;
+    }
+}
+
+bool chip8Profiler::writeHeatmap(const char *path) const
+{
+    FILE *fptr = fopen(path, "wb");
+    if(fptr == NULL)
+    {
+        return false;
+    }
+
+    ///< Each channel is scaled against its own maximum on a log scale
+    double logMax[NUM_ACCESSES];
+    for(int a = 0; a < NUM_ACCESSES; a++)
+    {
+        unsigned long peak = *std::max_element(counts[a].begin(), counts[a].end());
+        logMax[a] = log1p((double)peak);
+    }
+
+    unsigned int rows = (mask + 1) / HEATMAP_WIDTH;
+    unsigned int width = HEATMAP_WIDTH * HEATMAP_SCALE;
+    fprintf(fptr, "P6\n%u %u\n255\n", width, rows * HEATMAP_SCALE);
+
+    std::vector<unsigned char> line(width * 3);
+    for(unsigned int row = 0; row < rows; row++)
+    {
+        for(unsigned int col = 0; col < HEATMAP_WIDTH; col++)
+        {
+            unsigned int address = row * HEATMAP_WIDTH + col;
+            unsigned char level[NUM_ACCESSES];
+            for(int a = 0; a < NUM_ACCESSES; a++)
+            {
+                ///< An instruction lights up both of its bytes
+                unsigned long n = counts[a][address];
+                if(a == ACCESS_EXECUTE)
+                {
+                    n += counts[a][(address - 1) & mask];
+                }
+                level[a] = (n && logMax[a] > 0) ? (unsigned char)(64 + 191 * std::min(1.0, log1p((double)n) / logMax[a])) : 0;
+            }
+            for(int s = 0; s < HEATMAP_SCALE; s++)
+            {
+                unsigned char *px = &line[(col * HEATMAP_SCALE + s) * 3];
+                px[0] = level[ACCESS_WRITE];
+                px[1] = level[ACCESS_EXECUTE];
+                px[2] = level[ACCESS_READ];
+            }
+        }
+        for(int s = 0; s < HEATMAP_SCALE; s++)
+        {
+            fwrite(line.data(), 1, line.size(), fptr);
+        }
+    }
+
+    return fclose(fptr) == 0;
+}
+
+void chip8Profiler::printReport(FILE *out) const
+{
+    unsigned long touched[NUM_ACCESSES] = {0, 0, 0};
+    for(unsigned int address = 0; address <= mask; address++)
+    {
+        for(int a = 0; a < NUM_ACCESSES; a++)
+        {
+            touched[a] += counts[a][address] != 0;
+        }
+    }
+
+    fprintf(out, "Instructions: %lu (%s profile)\n", totalInstructions, quirksName(c8.quirks));
+    fprintf(out, "Addresses: %lu instructions, %lu bytes read, %lu bytes written\n",
+            touched[ACCESS_EXECUTE], touched[ACCESS_READ], touched[ACCESS_WRITE]);
+    printRegions(out);
+    printHottest(out);
+    printCoverage(out);
+}
+
+void chip8Profiler::printRegions(FILE *out) const
+{
+    static const char *kinds[8] = {
+        "", "code", "data", "code, data", "written", "code, written", "data, written", "code, data, written"
+    };
+
+    fprintf(out, "\nRegions:\n");
+    unsigned int start = 0;
+    int current = 0;
+    for(unsigned int address = 0; address <= mask + 1; address++)
+    {
+        int kind = 0;
+        if(address <= mask)
+        {
+            kind = ((counts[ACCESS_EXECUTE][address] || counts[ACCESS_EXECUTE][(address - 1) & mask]) ? 1 : 0) |
+                   (counts[ACCESS_READ][address] ? 2 : 0) |
+                   (counts[ACCESS_WRITE][address] ? 4 : 0);
+        }
+        if(kind != current)
+        {
+            if(current != 0)
+            {
+                fprintf(out, "  %04X-%04X  %5u bytes  %s\n", start, address - 1, address - start, kinds[current]);
+            }
+            start = address;
+            current = kind;
+        }
+    }
+}
+
+void chip8Profiler::printHottest(FILE *out) const
+{
+    std::vector<unsigned int> addresses;
+    for(unsigned int address = 0; address <= mask; address++)
+    {
+        if(counts[ACCESS_EXECUTE][address])
+        {
+            addresses.push_back(address);
+        }
+    }
+
+    size_t shown = std::min(addresses.size(), (size_t)HOTTEST_COUNT);
+    std::partial_sort(addresses.begin(), addresses.begin() + shown, addresses.end(),
+                      [this](unsigned int a, unsigned int b) { return counts[ACCESS_EXECUTE][a] > counts[ACCESS_EXECUTE][b]; });
+
+    fprintf(out, "\nHottest instructions:\n");
+    for(size_t i = 0; i < shown; i++)
+    {
+        unsigned int address = addresses[i];
+        unsigned long n = counts[ACCESS_EXECUTE][address];
+        fprintf(out, "  %04X  %02X%02X  %12lu  %5.1f%%\n", address, c8.memory[address], c8.memory[address + 1],
+                n, 100.0 * n / totalInstructions);
+    }
+}
+
+void chip8Profiler::printCoverage(FILE *out) const
+{
+    int covered = 0;
+    fprintf(out, "\nOpcodes:\n");
+    for(int op = 0; op < NUM_OPCODES; op++)
+    {
+        if(opcodes[op + 1])
+        {
+            fprintf(out, "  %s  %12lu  %5.1f%%\n", opcodeName(op), opcodes[op + 1],
+                    100.0 * opcodes[op + 1] / totalInstructions);
+            covered++;
+        }
+    }
+    if(opcodes[0])
+    {
+        fprintf(out, "  unknown  %9lu\n", opcodes[0]);
+    }
+
+    ///< Only opcodes the profile can run count towards coverage
+    int available = 0;
+    for(int op = 0; op < NUM_OPCODES; op++)
+    {
+        available += decoder.supports(op);
+    }
+    fprintf(out, "Covered %d of %d %s opcodes, never run:", covered, available, quirksName(profile));
+    for(int op = 0; op < NUM_OPCODES; op++)
+    {
+        if(!opcodes[op + 1] && decoder.supports(op))
+        {
+            fprintf(out, " %s", opcodeName(op));
+        }
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,67 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+#include <vector>
+#include "access.h"
+#include "chip8.h"
+
+#define PROFILE_CYCLES_PER_FRAME    10
+///< Heat map layout: bytes per row and pixels per byte
+#define HEATMAP_WIDTH               64
+#define HEATMAP_SCALE               4
+
+///< How one memory address was used
+typedef enum {
+    ACCESS_EXECUTE,     ///< An instruction started at the address
+    ACCESS_READ,        ///< Read as data: sprites, FX65, 5XY3, F002 and the F000 operand
+    ACCESS_WRITE,       ///< Written by FX33, FX55 or 5XY2
+    NUM_ACCESSES
+} ACCESS_t;
+
+/**
+ * Memory access and opcode coverage profiler. Like the debugger it drives
+ * a chip8 from the outside and decodes each opcode before it runs, so the
+ * core has no counters and costs nothing when nobody profiles it. Frames
+ * run the unfused single step loop followed by one timer tick, the same
+ * machine state emulateFrame produces with TIMING_FIXED.
+ */
+class chip8Profiler
+{
+    public:
+        explicit chip8Profiler(chip8 &target);
+
+        ///< Runs one 60Hz frame with counting
+        void runFrame(int cycles = PROFILE_CYCLES_PER_FRAME);
+        ///< Zeroes the counters and sets them up for the current profile and address space
+        void clear();
+
+        unsigned long count(ACCESS_t access, unsigned int address) const { return counts[access][address & mask]; }
+        ///< Times the opcode with the given index (decode order of chip8.cpp) ran, -1 for unknown opcodes
+        unsigned long opcodeCount(int op) const { return opcodes[op + 1]; }
+        static const char *opcodeName(int op) { return chip8Decoder::opcodeName(op); }
+        unsigned long instructions() const { return totalInstructions; }
+
+        ///< Binary PPM, one block per byte: green execute, blue read, red write, log scaled
+        bool writeHeatmap(const char *path) const;
+        ///< Totals, code and data regions, hottest addresses and opcode coverage
+        void printReport(FILE *out) const;
+
+    private:
+        chip8 &c8;
+        unsigned int mask;
+        ///< Profile the counters were cleared for and its decoder
+        QUIRKS_t profile;
+        chip8Decoder decoder;
+        std::vector<unsigned long> counts[NUM_ACCESSES];
+        unsigned long opcodes[NUM_OPCODES + 1];
+        unsigned long totalInstructions;
+
+        void observe();
+        void countRange(ACCESS_t access, unsigned int start, unsigned int length);
+        void printRegions(FILE *out) const;
+        void printHottest(FILE *out) const;
+        void printCoverage(FILE *out) const;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,23 @@
+#include <string.h>
+#include "quirks.h"
+
+static const char *quirkNames[NUM_QUIRKS] = {
+    "modern", "vip", "chip48", "schip", "xochip"
+};
+
+QUIRKS_t quirksFromName(const char *name)
+{
+    for(int i = 0; i < NUM_QUIRKS; i++)
+    {
+        if(!strcmp(name, quirkNames[i]))
+        {
+            return (QUIRKS_t)i;
+        }
+    }
+    return NUM_QUIRKS;
+}
+
+const char *quirksName(QUIRKS_t quirks)
+{
+    return (quirks < NUM_QUIRKS) ? quirkNames[quirks] : "unknown";
+}
@@ -0,0 +1,83 @@
+#ifndef QUIRKS_H
+#define QUIRKS_H
+
+/**
+ * Quirk profiles for the instructions that CHIP-8 variants disagree on.
+ * Each profile is a policy class of compile time constants. The interpreter
+ * loop is instantiated once per profile, so the checks fold away and no
+ * handler tests a flag at run time.
+ */
+typedef enum {
+    QUIRKS_MODERN,      ///< Behaviour of this emulator before profiles existed
+    QUIRKS_VIP,         ///< Original COSMAC VIP interpreter
+    QUIRKS_CHIP48,      ///< HP48 CHIP-48
+    QUIRKS_SCHIP,       ///< SUPER-CHIP 1.1
+    QUIRKS_XOCHIP,      ///< XO-CHIP, 64k memory and two bit planes
+    NUM_QUIRKS
+} QUIRKS_t;
+
+///< How FX55/FX65 leave I behind
+#define LOADSTORE_KEEP_I    0   ///< I unchanged
+#define LOADSTORE_ADD_X     1   ///< I += X
+#define LOADSTORE_ADD_X1    2   ///< I += X + 1
+
+struct quirksModern
+{
+    static const bool shiftUsesVY = false;      ///< 8XY6/8XYE shift VY into VX
+    static const int  loadStore = LOADSTORE_ADD_X1;
+    static const bool jumpUsesVX = false;       ///< BNNN becomes BXNN, jumping to XNN + VX
+    static const bool clipSprites = false;      ///< DXYN clips at the screen edge instead of wrapping
+    static const bool logicResetsVF = false;    ///< 8XY1/8XY2/8XY3 clear VF
+    static const bool superChip = true;         ///< Decode the SUPER-CHIP opcodes
+    static const bool xoChip = false;            ///< XO-CHIP opcodes, 64k memory and planes
+};
+
+struct quirksVip
+{
+    static const bool shiftUsesVY = true;
+    static const int  loadStore = LOADSTORE_ADD_X1;
+    static const bool jumpUsesVX = false;
+    static const bool clipSprites = true;
+    static const bool logicResetsVF = true;
+    static const bool superChip = false;
+    static const bool xoChip = false;
+};
+
+struct quirksChip48
+{
+    static const bool shiftUsesVY = false;
+    static const int  loadStore = LOADSTORE_ADD_X;
+    static const bool jumpUsesVX = true;
+    static const bool clipSprites = true;
+    static const bool logicResetsVF = false;
+    static const bool superChip = false;
+    static const bool xoChip = false;
+};
+
+struct quirksSchip
+{
+    static const bool shiftUsesVY = false;
+    static const int  loadStore = LOADSTORE_KEEP_I;
+    static const bool jumpUsesVX = true;
+    static const bool clipSprites = true;
+    static const bool logicResetsVF = false;
+    static const bool superChip = true;
+    static const bool xoChip = false;
+};
+
+struct quirksXoChip
+{
+    static const bool shiftUsesVY = true;
+    static const int  loadStore = LOADSTORE_ADD_X1;
+    static const bool jumpUsesVX = false;
+    static const bool clipSprites = false;
+    static const bool logicResetsVF = false;
+    static const bool superChip = true;
+    static const bool xoChip = true;
+};
+
+///< Returns NUM_QUIRKS for an unknown name
+QUIRKS_t quirksFromName(const char *name);
+const char *quirksName(QUIRKS_t quirks);
+
+#endif // QUIRKS_H
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include "romdb.h"
+
+bool romDatabase::load(const char *path)
+{
+    FILE *fptr = fopen(path, "r");
+    if(fptr == NULL)
+    {
+        return false;
+    }
+
+    char line[512];
+    int lineNumber = 0;
+    while(fgets(line, sizeof(line), fptr) != NULL)
+    {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if(comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        unsigned long long hash;
+        char profile[16], keymap[32];
+        int cycles, nameStart = -1;
+        int fields = sscanf(line, "%llx %15s %d %31s %n", &hash, profile, &cycles, keymap, &nameStart);
+        if(fields <= 0)
+        {
+            continue;
+        }
+
+        romInfo info;
+        info.hash = hash;
+        info.quirks = (fields >= 2) ? quirksFromName(profile) : NUM_QUIRKS;
+        info.cyclesPerFrame = cycles;
+        if(fields < 4 || info.quirks == NUM_QUIRKS || cycles <= 0 ||
+           (strcmp(keymap, "-") && strlen(keymap) != KEYPAD_SIZE))
+        {
+            fprintf(stderr, "%s:%d: bad entry\n", path, lineNumber);
+            continue;
+        }
+        memcpy(info.keymap, strcmp(keymap, "-") ? keymap : ROMDB_DEFAULT_KEYMAP, KEYPAD_SIZE);
+
+        info.name = (nameStart >= 0) ? line + nameStart : "";
+        info.name.erase(info.name.find_last_not_of(" \t\r\n") + 1);
+        entries[hash] = info;
+    }
+    fclose(fptr);
+    return true;
+}
+
+const romInfo *romDatabase::lookup(unsigned long long hash) const
+{
+    std::unordered_map<unsigned long long, romInfo>::const_iterator it = entries.find(hash);
+    return (it == entries.end()) ? NULL : &it->second;
+}
+
+romImage::romImage()
+    : inDatabase(false), romSize(0)
+{
+}
+
+bool romImage::load(const unsigned char *data, size_t size, const romDatabase *db, QUIRKS_t quirks)
+{
+    unsigned long long hash = romHash(data, size);
+    const romInfo *entry = (db != NULL) ? db->lookup(hash) : NULL;
+
+    romInfo info;
+    if(entry != NULL)
+    {
+        info = *entry;
+    }
+    else
+    {
+        info.hash = hash;
+        info.quirks = QUIRKS_MODERN;
+        info.cyclesPerFrame = ROMDB_CYCLES_PER_FRAME;
+        memcpy(info.keymap, ROMDB_DEFAULT_KEYMAP, KEYPAD_SIZE);
+    }
+
+    if(quirks != NUM_QUIRKS)
+    {
+        info.quirks = quirks;
+    }
+
+    ///< loadRom rejects ROMs that don't fit after 0x200 for the profile,
+    ///< the image only describes a ROM once it has booted
+    if(!boot.loadRom(data, size, info.quirks))
+    {
+        return false;
+    }
+    romData = info;
+    inDatabase = entry != NULL;
+    romSize = size;
+    return true;
+}
+
+bool romImage::loadFile(const char *path, const romDatabase *db, QUIRKS_t quirks)
+{
+    romFile file;
+    if(!file.open(path))
+    {
+        return false;
+    }
+    return load(file.data(), file.size(), db, quirks);
+}
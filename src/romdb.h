@@ -0,0 +1,77 @@
+#ifndef ROMDB_H
+#define ROMDB_H
+
+#include <string>
+#include <unordered_map>
+#include "chip8.h"
+#include "romfile.h"
+
+#define ROMDB_PATH              "roms/roms.db"
+#define ROMDB_CYCLES_PER_FRAME  10
+///< Host keys for chip8 keys 0-F: the 1234/QWER/ASDF/ZXCV block
+#define ROMDB_DEFAULT_KEYMAP    "x123qweasdzc4rfv"
+
+///< What the database knows about one ROM
+struct romInfo
+{
+    unsigned long long hash;
+    QUIRKS_t quirks;
+    int cyclesPerFrame;
+    char keymap[KEYPAD_SIZE];   ///< Host key for each chip8 key
+    std::string name;
+};
+
+/**
+ * Text database, one ROM per line, '#' starts a comment:
+ *   <hash> <profile> <cycles per frame> <keymap|-> <name>
+ * hash is romHash() in hex, keymap is 16 host keys for chip8 keys 0-F and
+ * '-' keeps ROMDB_DEFAULT_KEYMAP.
+ */
+class romDatabase
+{
+    public:
+        ///< Returns false if the file cannot be read, bad lines are reported and skipped
+        bool load(const char *path = ROMDB_PATH);
+        ///< NULL for unknown ROMs
+        const romInfo *lookup(unsigned long long hash) const;
+        size_t size() const { return entries.size(); }
+
+    private:
+        std::unordered_map<unsigned long long, romInfo> entries;
+};
+
+/**
+ * A ROM checked and booted once. The boot state is a chip8 with the font
+ * and program already in memory and the memory hash computed, so resetting
+ * an instance is one copy of it instead of initialize() plus a reload.
+ */
+class romImage
+{
+    public:
+        romImage();
+
+        /**
+         * Uses the database entry when there is one, otherwise the defaults.
+         * quirks overrides the profile, NUM_QUIRKS takes it from the database
+         * (QUIRKS_MODERN for unknown ROMs). False if the ROM does not fit.
+         */
+        bool load(const unsigned char *data, size_t size, const romDatabase *db = NULL, QUIRKS_t quirks = NUM_QUIRKS);
+        ///< mmaps the file, hashes it and loads it
+        bool loadFile(const char *path, const romDatabase *db = NULL, QUIRKS_t quirks = NUM_QUIRKS);
+
+        void reset(chip8 &c8) const { c8 = boot; }
+        ///< Carried into every machine reset from the image
+        void setVerbose(bool enable) { boot.setVerbose(enable); }
+
+        const romInfo &info() const { return romData; }
+        bool known() const { return inDatabase; }
+        size_t size() const { return romSize; }
+
+    private:
+        chip8 boot;
+        romInfo romData;
+        bool inDatabase;
+        size_t romSize;
+};
+
+#endif // ROMDB_H
@@ -0,0 +1,160 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "romfile.h"
+
+#define FNV_OFFSET  0xCBF29CE484222325ULL
+#define FNV_PRIME   0x100000001B3ULL
+
+///< Zip record signatures and the fixed part of each record
+#define ZIP_LOCAL_SIG       0x04034B50
+#define ZIP_CENTRAL_SIG     0x02014B50
+#define ZIP_END_SIG         0x06054B50
+#define ZIP_LOCAL_SIZE      30
+#define ZIP_CENTRAL_SIZE    46
+#define ZIP_END_SIZE        22
+#define ZIP_MAX_COMMENT     65535
+#define ZIP_STORED          0
+#define ZIP_ENCRYPTED       0x1
+
+static unsigned int read16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int read32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+romFile::romFile()
+    : map(NULL), length(0), rom(NULL), romLength(0)
+{
+}
+
+romFile::~romFile()
+{
+    close();
+}
+
+bool romFile::open(const char *path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    ///< An empty file maps to nothing, data() stays NULL
+    if(st.st_size > 0)
+    {
+        void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p == MAP_FAILED)
+        {
+            ::close(fd);
+            return false;
+        }
+        map = (const unsigned char *)p;
+        length = st.st_size;
+    }
+    ::close(fd);
+
+    rom = map;
+    romLength = length;
+    if(length >= 4 && read32(map) == ZIP_LOCAL_SIG && !findZipEntry())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool romFile::findZipEntry()
+{
+    ///< The end record is the last one, followed only by the archive comment
+    if(length < ZIP_END_SIZE)
+    {
+        return false;
+    }
+    size_t end = length - ZIP_END_SIZE;
+    size_t stop = (end > ZIP_MAX_COMMENT) ? end - ZIP_MAX_COMMENT : 0;
+    while(read32(map + end) != ZIP_END_SIG)
+    {
+        if(end == stop)
+        {
+            return false;
+        }
+        end--;
+    }
+
+    ///< Sizes come from the central directory, local headers may leave them to a trailing descriptor
+    size_t entry = read32(map + end + 16);
+    for(unsigned int n = read16(map + end + 10); n > 0; n--)
+    {
+        if(entry + ZIP_CENTRAL_SIZE > length || read32(map + entry) != ZIP_CENTRAL_SIG)
+        {
+            return false;
+        }
+        const unsigned char *c = map + entry;
+        unsigned int nameLength = read16(c + 28);
+        size_t size = read32(c + 24);
+        size_t local = read32(c + 42);
+        entry += ZIP_CENTRAL_SIZE + nameLength + read16(c + 30) + read16(c + 32);
+
+        ///< Directories are names ending in a slash, skip them
+        if(entry > length || nameLength == 0 || c[ZIP_CENTRAL_SIZE + nameLength - 1] == '/')
+        {
+            continue;
+        }
+        ///< The first file is the ROM, it has to be usable in place
+        if((read16(c + 8) & ZIP_ENCRYPTED) || read16(c + 10) != ZIP_STORED || read32(c + 20) != size)
+        {
+            return false;
+        }
+        if(local + ZIP_LOCAL_SIZE > length || read32(map + local) != ZIP_LOCAL_SIG)
+        {
+            return false;
+        }
+        size_t start = local + ZIP_LOCAL_SIZE + read16(map + local + 26) + read16(map + local + 28);
+        if(start > length || size > length - start)
+        {
+            return false;
+        }
+        rom = map + start;
+        romLength = size;
+        return true;
+    }
+    return false;
+}
+
+void romFile::close()
+{
+    if(map != NULL)
+    {
+        munmap((void *)map, length);
+        map = NULL;
+    }
+    length = 0;
+    rom = NULL;
+    romLength = 0;
+}
+
+unsigned long long romHash(const unsigned char *data, size_t size)
+{
+    unsigned long long h = FNV_OFFSET;
+    for(size_t i = 0; i < size; i++)
+    {
+        h = (h ^ data[i]) * FNV_PRIME;
+    }
+    return h;
+}
@@ -0,0 +1,40 @@
+#ifndef ROMFILE_H
+#define ROMFILE_H
+
+#include <stddef.h>
+
+/**
+ * Read only memory mapping of a ROM file. The bytes are used in place, the
+ * only copy is the one into chip8 memory. A zip archive maps to its first
+ * file, which has to be stored uncompressed so it can be used in place
+ * too; deflated archives fail to open. Not copyable.
+ */
+class romFile
+{
+    public:
+        romFile();
+        ~romFile();
+
+        bool open(const char *path);
+        void close();
+
+        const unsigned char *data() const { return rom; }
+        size_t size() const { return romLength; }
+
+    private:
+        romFile(const romFile &);
+        romFile &operator=(const romFile &);
+
+        bool findZipEntry();
+
+        const unsigned char *map;
+        size_t length;
+        ///< The ROM inside the mapping, all of it unless it is a zip archive
+        const unsigned char *rom;
+        size_t romLength;
+};
+
+///< 64 bit FNV-1a of a ROM's bytes, identifies it in the ROM database
+unsigned long long romHash(const unsigned char *data, size_t size);
+
+#endif // ROMFILE_H
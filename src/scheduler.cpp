@@ -0,0 +1,190 @@
+#include "scheduler.h"
+
+chip8Scheduler::chip8Scheduler(int numThreads, int cyclesPerFrame)
+    : numThreads(numThreads), cyclesPerFrame(cyclesPerFrame),
+      period(std::chrono::nanoseconds(SCHED_FRAME_NS)), quit(false)
+{
+    if(this->numThreads <= 0)
+    {
+        this->numThreads = std::thread::hardware_concurrency();
+    }
+    totals = schedulerStats();
+}
+
+chip8Scheduler::~chip8Scheduler()
+{
+    stop();
+}
+
+int chip8Scheduler::add(const unsigned char *data, size_t size, QUIRKS_t quirks)
+{
+    std::unique_ptr<task> t(new task);
+    t->c8.setVerbose(false);
+    if(!t->c8.loadRom(data, size, quirks))
+    {
+        return -1;
+    }
+    return enqueue(std::move(t));
+}
+
+int chip8Scheduler::add(const romImage &image)
+{
+    std::unique_ptr<task> t(new task);
+    image.reset(t->c8);
+    t->c8.setVerbose(false);
+    return enqueue(std::move(t));
+}
+
+int chip8Scheduler::enqueue(std::unique_ptr<task> t)
+{
+    t->keys.store(0);
+    t->parked = false;
+
+    std::lock_guard<std::mutex> guard(lock);
+    int id = (int)tasks.size();
+    t->release = clock::now();
+    entry e = {t->release + period, id};
+    tasks.push_back(std::move(t));
+    queue.push(e);
+    wake.notify_one();
+    return id;
+}
+
+void chip8Scheduler::setKeys(int id, unsigned short mask)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    task &t = *tasks[id];
+    t.keys.store(mask, std::memory_order_relaxed);
+
+    ///< A parked instance only needs to run again once something is pressed
+    if(t.parked && mask != 0)
+    {
+        t.parked = false;
+        t.release = clock::now();
+        entry e = {t.release + period, id};
+        queue.push(e);
+        totals.wakeups++;
+        totals.parked--;
+        wake.notify_one();
+    }
+}
+
+void chip8Scheduler::start()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = false;
+
+        ///< Spread the releases over one period so the frames don't all fall due at once
+        queue = std::priority_queue<entry, std::vector<entry>, std::greater<entry>>();
+        clock::time_point now = clock::now();
+        for(size_t i = 0; i < tasks.size(); i++)
+        {
+            if(tasks[i]->parked)
+            {
+                continue;
+            }
+            tasks[i]->release = now + period * i / tasks.size();
+            entry e = {tasks[i]->release + period, (int)i};
+            queue.push(e);
+        }
+    }
+    for(int i = 0; i < numThreads; i++)
+    {
+        workers.push_back(std::thread(&chip8Scheduler::workerLoop, this));
+    }
+}
+
+void chip8Scheduler::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = true;
+    }
+    wake.notify_all();
+    for(size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    workers.clear();
+}
+
+schedulerStats chip8Scheduler::stats() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return totals;
+}
+
+int chip8Scheduler::size() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return (int)tasks.size();
+}
+
+void chip8Scheduler::workerLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    while(!quit)
+    {
+        if(queue.empty())
+        {
+            wake.wait(guard);
+            continue;
+        }
+
+        ///< Every frame is one period long, so the earliest deadline is also the earliest release
+        entry next = queue.top();
+        task &t = *tasks[next.id];
+        if(t.release > clock::now())
+        {
+            wake.wait_until(guard, t.release);
+            continue;
+        }
+        queue.pop();
+
+        guard.unlock();
+        runFrame(t);
+        clock::time_point finished = clock::now();
+        guard.lock();
+
+        totals.frames++;
+        if(finished > next.deadline)
+        {
+            double late = std::chrono::duration<double, std::micro>(finished - next.deadline).count();
+            totals.misses++;
+            if(late > totals.maxLatenessUs)
+            {
+                totals.maxLatenessUs = late;
+            }
+        }
+
+        if(t.c8.waitingForKey() && t.keys.load(std::memory_order_relaxed) == 0)
+        {
+            t.parked = true;
+            totals.parked++;
+            continue;
+        }
+
+        t.release += period;
+        if(t.release + period < finished)
+        {
+            ///< More than a whole frame behind, drop the backlog instead of bursting to catch up
+            totals.skipped += (finished - t.release) / period;
+            t.release = finished;
+        }
+        entry e = {t.release + period, next.id};
+        queue.push(e);
+        wake.notify_one();
+    }
+}
+
+void chip8Scheduler::runFrame(task &t)
+{
+    unsigned int mask = t.keys.load(std::memory_order_relaxed);
+    for(int k = 0; k < KEYPAD_SIZE; k++)
+    {
+        t.c8.key[k] = (mask >> k) & 1;
+    }
+    t.c8.emulateFrame(cyclesPerFrame);
+}
@@ -0,0 +1,88 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+#include "romdb.h"
+
+#define SCHED_CYCLES_PER_FRAME  10
+#define SCHED_FRAME_NS          16666667
+
+struct schedulerStats
+{
+    unsigned long frames;       ///< Frames emulated
+    unsigned long misses;       ///< Frames that finished after their deadline
+    unsigned long skipped;      ///< Frames dropped after falling a whole period behind
+    unsigned long wakeups;      ///< Parked instances woken by input
+    int parked;                 ///< Instances currently parked in FX0A
+    double maxLatenessUs;       ///< Worst finish time past a deadline
+};
+
+/**
+ * Runs many chip8 instances in real time on a few threads. Every instance
+ * has a 60Hz frame released at the start of its period and due at the end.
+ * Workers always take the released frame with the earliest deadline (EDF)
+ * and sleep until the next release when nothing is due. An instance waiting
+ * in FX0A with no key and idle timers is parked: it leaves the queue until
+ * setKeys() presses something, since running it would change nothing.
+ */
+class chip8Scheduler
+{
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        chip8Scheduler(int numThreads, int cyclesPerFrame = SCHED_CYCLES_PER_FRAME);
+        ~chip8Scheduler();
+
+        ///< Returns the instance id, -1 if the ROM does not fit. Can be called while running
+        int add(const unsigned char *data, size_t size, QUIRKS_t quirks = QUIRKS_MODERN);
+        ///< Starts a copy of the image's boot state, no reload
+        int add(const romImage &image);
+        ///< Bit N of mask is key N, applied at the start of the instance's next frame
+        void setKeys(int id, unsigned short mask);
+
+        void start();
+        void stop();
+
+        schedulerStats stats() const;
+        int size() const;
+
+    private:
+        struct task
+        {
+            chip8 c8;
+            std::atomic<unsigned int> keys;
+            clock::time_point release;
+            bool parked;
+        };
+        struct entry
+        {
+            clock::time_point deadline;
+            int id;
+            bool operator>(const entry &other) const { return deadline > other.deadline; }
+        };
+
+        int numThreads;
+        int cyclesPerFrame;
+        clock::duration period;
+        std::vector<std::unique_ptr<task>> tasks;
+        std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+        std::vector<std::thread> workers;
+        mutable std::mutex lock;
+        std::condition_variable wake;
+        bool quit;
+        schedulerStats totals;
+
+        int enqueue(std::unique_ptr<task> t);
+        void workerLoop();
+        void runFrame(task &t);
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <thread>
+#include "shmexport.h"
+
+static_assert(std::atomic<unsigned long long>::is_always_lock_free &&
+              std::atomic<unsigned int>::is_always_lock_free,
+              "shared memory counters must be lock free to work across processes");
+
+shmExporter::shmExporter()
+    : ring(NULL), frame(0)
+{
+    name[0] = '\0';
+}
+
+shmExporter::~shmExporter()
+{
+    close();
+}
+
+bool shmExporter::open(const char *shmName)
+{
+    close();
+
+    int fd = shm_open(shmName, O_CREAT | O_RDWR, 0644);
+    if(fd < 0)
+    {
+        perror("shm_open");
+        return false;
+    }
+    if(ftruncate(fd, sizeof(shmRing)) != 0)
+    {
+        perror("ftruncate");
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, sizeof(shmRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED)
+    {
+        perror("mmap");
+        return false;
+    }
+
+    ring = (shmRing *)map;
+    ring->published.store(0, std::memory_order_relaxed);
+    for(int i = 0; i < SHM_EXPORT_SLOTS; i++)
+    {
+        ring->frames[i].seq.store(0, std::memory_order_relaxed);
+    }
+    ring->slots = SHM_EXPORT_SLOTS;
+    ring->frameSize = sizeof(shmFrameData);
+    ring->version = SHM_EXPORT_VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    ring->magic = SHM_EXPORT_MAGIC;
+
+    snprintf(name, sizeof(name), "%s", shmName);
+    frame = 0;
+    return true;
+}
+
+void shmExporter::close()
+{
+    if(ring != NULL)
+    {
+        munmap(ring, sizeof(shmRing));
+        shm_unlink(name);
+        ring = NULL;
+    }
+}
+
+void shmExporter::publish(const chip8 &c8, const shmCounters &counters)
+{
+    if(ring == NULL)
+    {
+        return;
+    }
+
+    shmRing::slot &s = ring->frames[frame % SHM_EXPORT_SLOTS];
+    unsigned int seq = s.seq.load(std::memory_order_relaxed);
+
+    ///< Odd while writing, readers that saw the old value will retry
+    s.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s.data.frame = frame;
+    s.data.counters = counters;
+    s.data.pc = c8.getPc();
+    memcpy(s.data.V, c8.getRegisters(), REGISTER_SIZE);
+    s.data.hires = c8.hires();
+    memcpy(s.data.gfx, c8.gfx, sizeof(s.data.gfx));
+
+    s.seq.store(seq + 2, std::memory_order_release);
+    ring->published.store(++frame, std::memory_order_release);
+}
+
+shmReader::shmReader()
+    : ring(NULL)
+{
+}
+
+shmReader::~shmReader()
+{
+    close();
+}
+
+bool shmReader::open(const char *shmName)
+{
+    close();
+
+    int fd = shm_open(shmName, O_RDONLY, 0);
+    if(fd < 0)
+    {
+        return false;
+    }
+    void *map = mmap(NULL, sizeof(shmRing), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    ring = (const shmRing *)map;
+    if(ring->magic != SHM_EXPORT_MAGIC || ring->version != SHM_EXPORT_VERSION ||
+       ring->slots != SHM_EXPORT_SLOTS || ring->frameSize != sizeof(shmFrameData))
+    {
+        fputs("Shared memory layout mismatch", stderr);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void shmReader::close()
+{
+    if(ring != NULL)
+    {
+        munmap((void *)ring, sizeof(shmRing));
+        ring = NULL;
+    }
+}
+
+bool shmReader::readLatest(shmFrameData &out) const
+{
+    ///< A writer that died mid publish leaves seq odd for good, so give up eventually
+    for(int attempt = 0; attempt < SHM_READ_ATTEMPTS; attempt++)
+    {
+        if(attempt > 0)
+        {
+            std::this_thread::yield();
+        }
+
+        unsigned long long published = ring->published.load(std::memory_order_acquire);
+        if(published == 0)
+        {
+            return false;
+        }
+
+        const shmRing::slot &s = ring->frames[(published - 1) % SHM_EXPORT_SLOTS];
+        unsigned int before = s.seq.load(std::memory_order_acquire);
+        if(before & 1)
+        {
+            continue;
+        }
+        memcpy(&out, &s.data, sizeof(out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(s.seq.load(std::memory_order_relaxed) == before)
+        {
+            return true;
+        }
+    }
+    return false;
+}
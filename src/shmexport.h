@@ -0,0 +1,95 @@
+#ifndef SHMEXPORT_H
+#define SHMEXPORT_H
+
+#include <atomic>
+#include "chip8.h"
+
+#define SHM_EXPORT_MAGIC    0x43385246  ///< "C8RF"
+#define SHM_EXPORT_VERSION  1
+///< Frames kept in the ring, a reader has this many frames to finish a copy
+#define SHM_EXPORT_SLOTS    8
+#define SHM_EXPORT_NAME     "/chip8"
+///< Torn reads retried before readLatest gives up on a frame
+#define SHM_READ_ATTEMPTS   64
+
+///< Live counters published with every frame
+struct shmCounters
+{
+    double instructionsPerSec;
+    double frameTimeUs;
+    unsigned long long droppedFrames;
+};
+
+///< One published frame, plain data so readers can copy it out
+struct shmFrameData
+{
+    unsigned long long frame;
+    shmCounters counters;
+    unsigned short pc;
+    unsigned char V[REGISTER_SIZE];
+    unsigned char hires;
+    unsigned long long gfx[NUM_PLANES][HIRES_HEIGHT][GFX_ROW_WORDS];
+};
+
+/**
+ * Shared memory layout. Every slot has a sequence counter that is odd while
+ * the writer is inside it (a seqlock): readers copy the slot and retry if
+ * the counter moved. The writer never waits for readers.
+ */
+struct shmRing
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int slots;
+    unsigned int frameSize;
+    ///< Frames published so far, the newest is in slot (published - 1) % slots
+    std::atomic<unsigned long long> published;
+    struct slot
+    {
+        std::atomic<unsigned int> seq;
+        shmFrameData data;
+    } frames[SHM_EXPORT_SLOTS];
+};
+
+/**
+ * Writer side. open() creates and maps the segment once; publish() is a
+ * handful of stores and a copy of the display, no allocation or system call.
+ */
+class shmExporter
+{
+    public:
+        shmExporter();
+        ~shmExporter();
+
+        bool open(const char *name = SHM_EXPORT_NAME);
+        ///< Unmaps and removes the segment
+        void close();
+        bool isOpen() const { return ring != NULL; }
+
+        void publish(const chip8 &c8, const shmCounters &counters);
+
+    private:
+        shmRing *ring;
+        unsigned long long frame;
+        char name[64];
+};
+
+///< Reader side, maps the segment read only
+class shmReader
+{
+    public:
+        shmReader();
+        ~shmReader();
+
+        bool open(const char *name = SHM_EXPORT_NAME);
+        void close();
+
+        ///< Copies the newest consistent frame, false if nothing was published yet
+        ///< or no consistent copy was had in SHM_READ_ATTEMPTS tries
+        bool readLatest(shmFrameData &out) const;
+
+    private:
+        const shmRing *ring;
+};
+
+#endif // SHMEXPORT_H
@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include "spectator.h"
+
+#define SPECTATOR_EVENTS    64
+#define SPECTATOR_HEADER    9
+
+///< Bytes in one encoded row: both planes, every word of the row
+#define ROW_BYTES(words)    (NUM_PLANES * (words) * 8)
+
+static size_t encodeFrame(unsigned char *out, const unsigned long long cur[NUM_PLANES][HIRES_HEIGHT][GFX_ROW_WORDS],
+                          const unsigned long long prev[NUM_PLANES][HIRES_HEIGHT][GFX_ROW_WORDS],
+                          bool hires, unsigned int frame)
+{
+    int words = hires ? GFX_ROW_WORDS : 1;
+    int height = hires ? HIRES_HEIGHT : GFX_HEIGHT;
+    unsigned char *p = out + 2;
+
+    *p++ = (prev == NULL) ? SPECTATOR_KEY : SPECTATOR_DELTA;
+    *p++ = hires;
+    for(int i = 0; i < 4; i++)
+    {
+        *p++ = (unsigned char)(frame >> (i * 8));
+    }
+    unsigned char *rowCount = p++;
+    *rowCount = 0;
+
+    for(int y = 0; y < height; y++)
+    {
+        unsigned char row[ROW_BYTES(GFX_ROW_WORDS)];
+        unsigned long long changed = 0;
+        int n = 0;
+
+        for(int plane = 0; plane < NUM_PLANES; plane++)
+        {
+            for(int w = 0; w < words; w++)
+            {
+                unsigned long long x = cur[plane][y][w] ^ ((prev == NULL) ? 0 : prev[plane][y][w]);
+                changed |= x;
+                for(int b = 0; b < 8; b++)
+                {
+                    row[n++] = (unsigned char)(x >> (56 - b * 8));
+                }
+            }
+        }
+        if(changed == 0)
+        {
+            continue;
+        }
+
+        *p++ = (unsigned char)y;
+        unsigned char *runs = p++;
+        *runs = 0;
+        for(int i = 0; i < n;)
+        {
+            int j = i + 1;
+            while(j < n && row[j] == row[i])
+            {
+                j++;
+            }
+            *p++ = (unsigned char)(j - i);
+            *p++ = row[i];
+            (*runs)++;
+            i = j;
+        }
+        (*rowCount)++;
+    }
+
+    size_t length = p - out - 2;
+    out[0] = (unsigned char)length;
+    out[1] = (unsigned char)(length >> 8);
+    return p - out;
+}
+
+////////////////////////////////////////////////////////////////////
+///< Server
+////////////////////////////////////////////////////////////////////
+spectatorServer::spectatorServer()
+    : listenFd(-1), epollFd(-1), dropped(0), frame(0), prevHires(false)
+{
+    path[0] = '\0';
+    memset(prev, 0, sizeof(prev));
+}
+
+spectatorServer::~spectatorServer()
+{
+    close();
+}
+
+bool spectatorServer::open(const char *socketPath)
+{
+    close();
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(socketPath) >= sizeof(addr.sun_path))
+    {
+        fputs("Socket path too long", stderr);
+        return false;
+    }
+    strcpy(addr.sun_path, socketPath);
+    unlink(socketPath);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if(listenFd < 0 || epollFd < 0 ||
+       bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+       listen(listenFd, SOMAXCONN) != 0)
+    {
+        perror("spectator socket");
+        close();
+        return false;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+
+    strcpy(path, socketPath);
+    frame = 0;
+    prevHires = false;
+    memset(prev, 0, sizeof(prev));
+    return true;
+}
+
+void spectatorServer::close()
+{
+    for(size_t i = 0; i < peers.size(); i++)
+    {
+        ::close(peers[i]->fd);
+        delete peers[i];
+    }
+    peers.clear();
+
+    if(listenFd >= 0)
+    {
+        ::close(listenFd);
+        unlink(path);
+        listenFd = -1;
+    }
+    if(epollFd >= 0)
+    {
+        ::close(epollFd);
+        epollFd = -1;
+    }
+}
+
+void spectatorServer::broadcast(const chip8 &c8)
+{
+    if(listenFd < 0)
+    {
+        return;
+    }
+    service();
+
+    ///< The delta is shared by every client that is in sync, the key frame is only built if someone needs it
+    bool hires = c8.hires();
+    bool layoutChanged = hires != prevHires;
+    size_t deltaLength = layoutChanged ? 0 : encodeFrame(delta, c8.gfx, prev, hires, frame);
+    size_t keyLength = 0;
+
+    for(size_t i = 0; i < peers.size(); i++)
+    {
+        peer *p = peers[i];
+        if(!p->pending.empty())
+        {
+            ///< Still sending an older frame, skip this one and resync later
+            p->needKey = true;
+            if(++p->stale > SPECTATOR_MAX_STALE)
+            {
+                drop(p);
+            }
+            continue;
+        }
+
+        if(p->needKey || layoutChanged)
+        {
+            if(keyLength == 0)
+            {
+                keyLength = encodeFrame(key, c8.gfx, NULL, hires, frame);
+            }
+            send(p, key, keyLength);
+            p->needKey = false;
+        }
+        else
+        {
+            send(p, delta, deltaLength);
+        }
+    }
+
+    ///< Closed clients are only removed here so indices stay valid above
+    for(size_t i = 0; i < peers.size();)
+    {
+        if(peers[i]->closed)
+        {
+            ::close(peers[i]->fd);
+            delete peers[i];
+            peers[i] = peers.back();
+            peers.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    memcpy(prev, c8.gfx, sizeof(prev));
+    prevHires = hires;
+    frame++;
+}
+
+void spectatorServer::service()
+{
+    struct epoll_event events[SPECTATOR_EVENTS];
+    int count = epoll_wait(epollFd, events, SPECTATOR_EVENTS, 0);
+
+    for(int i = 0; i < count; i++)
+    {
+        peer *p = (peer *)events[i].data.ptr;
+        if(p == NULL)
+        {
+            accept();
+            continue;
+        }
+        if(p->closed)
+        {
+            continue;
+        }
+        if(events[i].events & (EPOLLHUP | EPOLLERR))
+        {
+            p->closed = true;
+            continue;
+        }
+        if(events[i].events & EPOLLIN)
+        {
+            ///< Spectators never send anything, a read of 0 means they left
+            char scratch[64];
+            ssize_t n = recv(p->fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+            if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+            {
+                p->closed = true;
+                continue;
+            }
+        }
+        if(events[i].events & EPOLLOUT)
+        {
+            flush(p);
+        }
+    }
+}
+
+void spectatorServer::accept()
+{
+    for(;;)
+    {
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0)
+        {
+            return;
+        }
+
+        peer *p = new peer;
+        p->fd = fd;
+        p->needKey = true;
+        p->closed = false;
+        p->stale = 0;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
+        ev.data.ptr = p;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        peers.push_back(p);
+    }
+}
+
+void spectatorServer::send(peer *p, const unsigned char *data, size_t length)
+{
+    ssize_t n = ::send(p->fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if(n < 0)
+    {
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            p->closed = true;
+            return;
+        }
+        n = 0;
+    }
+    if((size_t)n < length)
+    {
+        ///< Keep the rest of this message, EPOLLOUT flushes it
+        p->pending.assign(data + n, data + length);
+    }
+    else
+    {
+        p->stale = 0;
+    }
+}
+
+void spectatorServer::flush(peer *p)
+{
+    if(p->pending.empty())
+    {
+        return;
+    }
+    ssize_t n = ::send(p->fd, &p->pending[0], p->pending.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    if(n < 0)
+    {
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            p->closed = true;
+        }
+        return;
+    }
+    p->pending.erase(p->pending.begin(), p->pending.begin() + n);
+    if(p->pending.empty())
+    {
+        p->stale = 0;
+    }
+}
+
+void spectatorServer::drop(peer *p)
+{
+    p->closed = true;
+    dropped++;
+}
+
+////////////////////////////////////////////////////////////////////
+///< Client
+////////////////////////////////////////////////////////////////////
+spectatorClient::spectatorClient()
+    : fd(-1), hiresMode(false), lastFrame(0)
+{
+    memset(gfx, 0, sizeof(gfx));
+}
+
+spectatorClient::~spectatorClient()
+{
+    close();
+}
+
+bool spectatorClient::connect(const char *socketPath)
+{
+    close();
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(socketPath) >= sizeof(addr.sun_path))
+    {
+        return false;
+    }
+    strcpy(addr.sun_path, socketPath);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0 || ::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close();
+        return false;
+    }
+    buffer.clear();
+    return true;
+}
+
+void spectatorClient::close()
+{
+    if(fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+int spectatorClient::poll()
+{
+    if(fd < 0)
+    {
+        return -1;
+    }
+
+    unsigned char chunk[SPECTATOR_MAX_MESSAGE];
+    for(;;)
+    {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+        if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            close();
+            return -1;
+        }
+        if(n < 0)
+        {
+            break;
+        }
+        buffer.insert(buffer.end(), chunk, chunk + n);
+    }
+
+    int frames = 0;
+    size_t offset = 0;
+    while(buffer.size() - offset >= 2)
+    {
+        size_t length = buffer[offset] | (buffer[offset + 1] << 8);
+        if(buffer.size() - offset - 2 < length)
+        {
+            break;
+        }
+        if(!decode(&buffer[offset + 2], length))
+        {
+            close();
+            return -1;
+        }
+        offset += 2 + length;
+        frames++;
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + offset);
+    return frames;
+}
+
+bool spectatorClient::decode(const unsigned char *msg, size_t length)
+{
+    if(length < SPECTATOR_HEADER - 2)
+    {
+        return false;
+    }
+
+    const unsigned char *end = msg + length;
+    bool keyFrame = msg[0] == SPECTATOR_KEY;
+    hiresMode = msg[1] != 0;
+    lastFrame = msg[2] | (msg[3] << 8) | (msg[4] << 16) | ((unsigned int)msg[5] << 24);
+    int rows = msg[6];
+    const unsigned char *p = msg + 7;
+    int words = hiresMode ? GFX_ROW_WORDS : 1;
+
+    if(keyFrame)
+    {
+        memset(gfx, 0, sizeof(gfx));
+    }
+
+    for(int r = 0; r < rows; r++)
+    {
+        if(end - p < 2)
+        {
+            return false;
+        }
+        int y = p[0] & (HIRES_HEIGHT - 1);
+        int runs = p[1];
+        p += 2;
+
+        unsigned char row[ROW_BYTES(GFX_ROW_WORDS)];
+        int n = 0;
+        for(int i = 0; i < runs; i++)
+        {
+            if(end - p < 2 || n + p[0] > ROW_BYTES(words))
+            {
+                return false;
+            }
+            memset(&row[n], p[1], p[0]);
+            n += p[0];
+            p += 2;
+        }
+        if(n != ROW_BYTES(words))
+        {
+            return false;
+        }
+
+        n = 0;
+        for(int plane = 0; plane < NUM_PLANES; plane++)
+        {
+            for(int w = 0; w < words; w++)
+            {
+                unsigned long long x = 0;
+                for(int b = 0; b < 8; b++)
+                {
+                    x = (x << 8) | row[n++];
+                }
+                gfx[plane][y][w] ^= x;
+            }
+        }
+    }
+    return p == end;
+}
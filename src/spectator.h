@@ -0,0 +1,116 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <vector>
+#include "chip8.h"
+
+#define SPECTATOR_PATH          "/tmp/chip8.sock"
+///< Frames a client may stay unwritable before it is dropped
+#define SPECTATOR_MAX_STALE     120
+///< Largest message: header plus every hires row with worst case run length pairs
+#define SPECTATOR_MAX_MESSAGE   (9 + HIRES_HEIGHT * (2 + 2 * NUM_PLANES * GFX_ROW_WORDS * 8))
+
+/**
+ * Message format, all sent as one stream per client:
+ *   u16 length (little endian, bytes after this field)
+ *   u8  type   SPECTATOR_KEY or SPECTATOR_DELTA
+ *   u8  hires
+ *   u32 frame number (little endian)
+ *   u8  number of rows that follow
+ *   per row: u8 y, u8 number of runs, then (u8 count, u8 byte) runs
+ * A row is both planes' words, MSB first, XORed with the same row of the
+ * previous frame (delta) or of a blank display (key). Unchanged rows are
+ * not sent. Run lengths cover the row exactly.
+ */
+typedef enum {
+    SPECTATOR_DELTA = 0,
+    SPECTATOR_KEY = 1
+} SPECTATOR_t;
+
+/**
+ * Broadcasts frames over a Unix domain socket. Everything runs on the
+ * caller's thread from broadcast(): an epoll set accepts clients, notices
+ * hangups and flushes partly sent messages. A frame is encoded once for all
+ * clients. A client whose socket is still full misses frames and gets a key
+ * frame once it catches up; after SPECTATOR_MAX_STALE frames it is dropped.
+ */
+class spectatorServer
+{
+    public:
+        spectatorServer();
+        ~spectatorServer();
+
+        bool open(const char *path = SPECTATOR_PATH);
+        void close();
+        bool isOpen() const { return listenFd >= 0; }
+
+        void broadcast(const chip8 &c8);
+
+        int clients() const { return (int)peers.size(); }
+        unsigned long droppedClients() const { return dropped; }
+
+    private:
+        struct peer
+        {
+            int fd;
+            bool needKey;
+            bool closed;
+            unsigned int stale;
+            std::vector<unsigned char> pending;
+        };
+
+        int listenFd;
+        int epollFd;
+        char path[108];
+        std::vector<peer *> peers;
+        unsigned long dropped;
+        unsigned int frame;
+        bool prevHires;
+        unsigned long long prev[NUM_PLANES][HIRES_HEIGHT][GFX_ROW_WORDS];
+        unsigned char delta[SPECTATOR_MAX_MESSAGE];
+        unsigned char key[SPECTATOR_MAX_MESSAGE];
+
+        void service();
+        void accept();
+        void send(peer *p, const unsigned char *data, size_t length);
+        void flush(peer *p);
+        void drop(peer *p);
+};
+
+/**
+ * Spectator side. Decodes into its own display, which has the same
+ * accessors as chip8 so the front end can draw it the same way.
+ */
+class spectatorClient
+{
+    public:
+        spectatorClient();
+        ~spectatorClient();
+
+        bool connect(const char *path = SPECTATOR_PATH);
+        void close();
+
+        ///< Reads what has arrived, returns the number of frames decoded or -1 once the server is gone
+        int poll();
+
+        unsigned long long gfx[NUM_PLANES][HIRES_HEIGHT][GFX_ROW_WORDS];
+        bool hires() const { return hiresMode; }
+        int displayWidth() const { return hiresMode ? HIRES_WIDTH : GFX_WIDTH; }
+        int displayHeight() const { return hiresMode ? HIRES_HEIGHT : GFX_HEIGHT; }
+        int pixel(int x, int y) const
+        {
+            return ((gfx[0][y][x >> 6] >> (63 - (x & 63))) & 1) |
+                   (((gfx[1][y][x >> 6] >> (63 - (x & 63))) & 1) << 1);
+        }
+        unsigned int frame() const { return lastFrame; }
+
+    private:
+        int fd;
+        bool hiresMode;
+        unsigned int lastFrame;
+        std::vector<unsigned char> buffer;
+
+        bool decode(const unsigned char *msg, size_t length);
+};
+
+#endif // SPECTATOR_H
@@ -0,0 +1,56 @@
+#include <time.h>
+#include "startup.h"
+
+#define NS_PER_SEC  1000000000LL
+
+static const char *milestoneNames[NUM_STARTUP_MARKS] = {
+    "ROM loaded", "display ready", "first instruction", "first frame"
+};
+
+static long long monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+startupTimer::startupTimer(FILE *out)
+    : origin(monotonicNs()), out(out)
+{
+    for(int i = 0; i < NUM_STARTUP_MARKS; i++)
+    {
+        marks[i] = 0;
+    }
+}
+
+void startupTimer::record(STARTUP_t milestone)
+{
+    marks[milestone] = monotonicNs();
+    if(milestone == STARTUP_FIRST_FRAME)
+    {
+        report();
+    }
+}
+
+double startupTimer::elapsedMs(STARTUP_t milestone) const
+{
+    return marks[milestone] ? (marks[milestone] - origin) / 1e6 : -1.0;
+}
+
+void startupTimer::report() const
+{
+    if(out == NULL)
+    {
+        return;
+    }
+    fprintf(out, "Startup:");
+    for(int i = 0; i < NUM_STARTUP_MARKS; i++)
+    {
+        if(marks[i])
+        {
+            fprintf(out, "%s %s %.2f ms", i ? "," : "", milestoneNames[i], elapsedMs((STARTUP_t)i));
+        }
+    }
+    fprintf(out, "\n");
+    fflush(out);
+}
@@ -0,0 +1,46 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <stdio.h>
+
+///< Startup milestones, in the order they normally happen
+typedef enum {
+    STARTUP_ROM_LOADED,         ///< ROM mapped, checked and booted
+    STARTUP_DISPLAY_READY,      ///< Window created, not reached in headless mode
+    STARTUP_FIRST_INSTRUCTION,  ///< First frame starts emulating
+    STARTUP_FIRST_FRAME,        ///< First frame drawn and presented
+    NUM_STARTUP_MARKS
+} STARTUP_t;
+
+/**
+ * Times the milestones from its own construction, which for a global is
+ * static initialisation right before main. Each milestone keeps its first
+ * mark, later marks cost one compare. The report is printed once, when the
+ * first frame is marked.
+ */
+class startupTimer
+{
+    public:
+        ///< out may be NULL to keep the report quiet
+        explicit startupTimer(FILE *out = stdout);
+
+        void mark(STARTUP_t milestone)
+        {
+            if(marks[milestone] == 0)
+            {
+                record(milestone);
+            }
+        }
+        ///< Milliseconds from construction, negative if not reached
+        double elapsedMs(STARTUP_t milestone) const;
+        void report() const;
+
+    private:
+        long long origin;
+        long long marks[NUM_STARTUP_MARKS];
+        FILE *out;
+
+        void record(STARTUP_t milestone);
+};
+
+#endif // STARTUP_H
@@ -0,0 +1,92 @@
+#include "stateset.h"
+
+///< Slot value meaning empty, a real hash of 0 is stored as 1
+#define EMPTY_SLOT  0ULL
+
+stateSet::stateSet(size_t capacity) : count(0), overflow(0)
+{
+    size_t size = 1;
+    while(size < capacity)
+    {
+        size <<= 1;
+    }
+    mask = size - 1;
+
+    slots = new std::atomic<unsigned long long>[size];
+    clear();
+}
+
+stateSet::~stateSet()
+{
+    delete[] slots;
+}
+
+void stateSet::clear()
+{
+    for(size_t i = 0; i <= mask; i++)
+    {
+        slots[i].store(EMPTY_SLOT, std::memory_order_relaxed);
+    }
+    count.store(0);
+    overflow.store(0);
+}
+
+bool stateSet::insert(unsigned long long hash)
+{
+    if(hash == EMPTY_SLOT)
+    {
+        hash = 1;
+    }
+
+    size_t index = (size_t)(hash ^ (hash >> 32)) & mask;
+    for(size_t probe = 0; probe <= mask; probe++)
+    {
+        unsigned long long current = slots[index].load(std::memory_order_acquire);
+        if(current == hash)
+        {
+            return false;
+        }
+        if(current == EMPTY_SLOT)
+        {
+            unsigned long long expected = EMPTY_SLOT;
+            if(slots[index].compare_exchange_strong(expected, hash, std::memory_order_acq_rel))
+            {
+                count.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            ///< Another thread claimed the slot first, it may have stored this hash
+            if(expected == hash)
+            {
+                return false;
+            }
+        }
+        index = (index + 1) & mask;
+    }
+
+    overflow.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool stateSet::contains(unsigned long long hash) const
+{
+    if(hash == EMPTY_SLOT)
+    {
+        hash = 1;
+    }
+
+    size_t index = (size_t)(hash ^ (hash >> 32)) & mask;
+    for(size_t probe = 0; probe <= mask; probe++)
+    {
+        unsigned long long current = slots[index].load(std::memory_order_acquire);
+        if(current == hash)
+        {
+            return true;
+        }
+        if(current == EMPTY_SLOT)
+        {
+            return false;
+        }
+        index = (index + 1) & mask;
+    }
+    return false;
+}
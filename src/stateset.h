@@ -0,0 +1,38 @@
+#ifndef STATESET_H
+#define STATESET_H
+
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * Fixed capacity lock free set of 64 bit state hashes, shared between threads.
+ * Open addressing with linear probing, slots are claimed with a single CAS.
+ */
+class stateSet
+{
+    public:
+        ///< capacity is rounded up to a power of two
+        explicit stateSet(size_t capacity);
+        ~stateSet();
+
+        ///< Returns true if the hash was not in the set before. When the set is
+        ///< full the hash is reported as new so nothing is wrongly pruned.
+        bool insert(unsigned long long hash);
+        bool contains(unsigned long long hash) const;
+        void clear();
+
+        size_t size() const { return count.load(std::memory_order_relaxed); }
+        size_t capacity() const { return mask + 1; }
+        size_t dropped() const { return overflow.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<unsigned long long> *slots;
+        size_t mask;
+        std::atomic<size_t> count;
+        std::atomic<size_t> overflow;
+
+        stateSet(const stateSet &);
+        stateSet &operator=(const stateSet &);
+};
+
+#endif // STATESET_H
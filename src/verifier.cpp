@@ -0,0 +1,230 @@
+#include "verifier.h"
+
+///< Key script: a new random key (or none) is held every KEY_HOLD_FRAMES frames
+#define KEY_HOLD_FRAMES 8
+
+chip8Verifier::chip8Verifier(int cyclesPerFrame, int checkInterval)
+    : cyclesPerFrame(cyclesPerFrame), checkInterval(checkInterval)
+{
+    reference.setVerbose(false);
+    candidate.setVerbose(false);
+}
+
+void chip8Verifier::boot(const unsigned char *rom, size_t size, QUIRKS_t quirks, unsigned int seed)
+{
+    reference.setFusion(false);
+    candidate.setFusion(true);
+    reference.loadRom(rom, size, quirks);
+    candidate.loadRom(rom, size, quirks);
+    reference.seedRandom(seed);
+    candidate.seedRandom(seed);
+}
+
+unsigned short chip8Verifier::scriptKeys(unsigned int seed, unsigned long frame)
+{
+    unsigned int r = seed ^ (unsigned int)(frame / KEY_HOLD_FRAMES) * 0x9E3779B9u;
+    r ^= r >> 16;
+    r *= 0x7FEB352Du;
+    r ^= r >> 15;
+    ///< Keys are released about a quarter of the time
+    return ((r & 0x30) == 0) ? 0 : (unsigned short)(1 << (r & 0xF));
+}
+
+void chip8Verifier::setKeys(chip8 &c8, unsigned short mask)
+{
+    for(int k = 0; k < KEYPAD_SIZE; k++)
+    {
+        c8.key[k] = (mask >> k) & 1;
+    }
+}
+
+bool chip8Verifier::agree(const chip8 &a, const chip8 &b)
+{
+    ///< The incremental hashes are only a quick reject: a fast path that misses
+    ///< a hash update leaves them agreeing, so a match is confirmed from scratch
+    if(a.stateHash() != b.stateHash())
+    {
+        return false;
+    }
+    unsigned long long full = a.computeStateHash();
+    return full == b.computeStateHash() && full == a.stateHash();
+}
+
+void chip8Verifier::runReference(chip8 &c8, int cycles) const
+{
+    c8.execute(c8, cycles);
+}
+
+void chip8Verifier::runCandidate(chip8 &c8, int cycles) const
+{
+    c8.executeFrame(c8, cycles);
+}
+
+verifyResult chip8Verifier::run(const unsigned char *rom, size_t size, QUIRKS_t quirks, unsigned long frames, unsigned int seed)
+{
+    verifyResult result = {true, 0, 0, 0, 0};
+    unsigned long lastGood = 0;
+    unsigned long sinceCheck = 0;
+
+    boot(rom, size, quirks, seed);
+
+    for(unsigned long f = 0; f < frames; f++)
+    {
+        unsigned short keys = scriptKeys(seed, f);
+        setKeys(reference, keys);
+        setKeys(candidate, keys);
+
+        runReference(reference, cyclesPerFrame);
+        reference.updateTimers();
+        runCandidate(candidate, cyclesPerFrame);
+        candidate.updateTimers();
+
+        sinceCheck += cyclesPerFrame;
+        if(sinceCheck >= (unsigned long)checkInterval || f + 1 == frames)
+        {
+            if(!agree(reference, candidate))
+            {
+                locate(rom, size, quirks, seed, lastGood, f, result);
+                return result;
+            }
+            lastGood = f + 1;
+            sinceCheck = 0;
+        }
+    }
+
+    result.instructions = frames * cyclesPerFrame;
+    result.frame = frames;
+    return result;
+}
+
+void chip8Verifier::locate(const unsigned char *rom, size_t size, QUIRKS_t quirks, unsigned int seed,
+                           unsigned long lastGood, unsigned long failed, verifyResult &result)
+{
+    result.match = false;
+    result.frame = failed;
+    result.instructions = (failed + 1) * cyclesPerFrame;
+    result.pc = reference.pc;
+    result.opcode = reference.fetchOpcode();
+
+    ///< Replay both engines from boot, the run is deterministic so they agree up to lastGood
+    boot(rom, size, quirks, seed);
+
+    for(unsigned long f = 0; f <= failed; f++)
+    {
+        unsigned short keys = scriptKeys(seed, f);
+        setKeys(reference, keys);
+        setKeys(candidate, keys);
+
+        if(f >= lastGood)
+        {
+            ///< Give the candidate a budget of k instructions from the frame start, for growing k
+            for(int k = 1; k <= cyclesPerFrame; k++)
+            {
+                chip8 ref = reference;
+                chip8 cand = candidate;
+                runReference(ref, k - 1);
+                unsigned short pc = ref.pc;
+                unsigned short opcode = ref.fetchOpcode();
+                runReference(ref, 1);
+                runCandidate(cand, k);
+
+                if(!agree(ref, cand))
+                {
+                    result.frame = f;
+                    result.instructions = f * cyclesPerFrame + k;
+                    result.pc = pc;
+                    result.opcode = opcode;
+                    reference = ref;
+                    candidate = cand;
+                    return;
+                }
+            }
+        }
+
+        runReference(reference, cyclesPerFrame);
+        reference.updateTimers();
+        runCandidate(candidate, cyclesPerFrame);
+        candidate.updateTimers();
+    }
+}
+
+void chip8Verifier::printDiff(FILE *out) const
+{
+    const chip8 &a = reference;
+    const chip8 &b = candidate;
+
+    #define DIFF_FIELD(name, value) \
+        if(a.value != b.value) fprintf(out, "  %-6s reference %04X candidate %04X\n", name, a.value, b.value)
+
+    DIFF_FIELD("pc", pc);
+    DIFF_FIELD("I", I);
+    DIFF_FIELD("sp", sp);
+    DIFF_FIELD("DT", delay_timer);
+    DIFF_FIELD("ST", sound_timer);
+    DIFF_FIELD("hires", hiresMode);
+    DIFF_FIELD("planes", planeMask);
+    DIFF_FIELD("rng", rngState);
+    DIFF_FIELD("pitch", pitch);
+    #undef DIFF_FIELD
+
+    for(int i = 0; i < REGISTER_SIZE; i++)
+    {
+        if(a.V[i] != b.V[i])
+        {
+            fprintf(out, "  V%X     reference %02X candidate %02X\n", i, a.V[i], b.V[i]);
+        }
+    }
+    for(int i = 0; i < STACK_SIZE; i++)
+    {
+        if(a.stack[i] != b.stack[i])
+        {
+            fprintf(out, "  stack[%X] reference %03X candidate %03X\n", i, a.stack[i], b.stack[i]);
+        }
+    }
+    for(int i = 0; i < RPL_SIZE; i++)
+    {
+        if(a.rplFlags[i] != b.rplFlags[i])
+        {
+            fprintf(out, "  rpl[%X]  reference %02X candidate %02X\n", i, a.rplFlags[i], b.rplFlags[i]);
+        }
+    }
+    for(int i = 0; i < AUDIO_PATTERN_SIZE; i++)
+    {
+        if(a.audioPattern[i] != b.audioPattern[i])
+        {
+            fprintf(out, "  audio[%X] reference %02X candidate %02X\n", i, a.audioPattern[i], b.audioPattern[i]);
+        }
+    }
+    for(unsigned int i = 0; i < a.memory.size(); i++)
+    {
+        if(a.memory[i] != b.memory[i])
+        {
+            fprintf(out, "  mem[%04X] reference %02X candidate %02X\n", i, a.memory[i], b.memory[i]);
+        }
+    }
+    const chip8 *engines[2] = {&a, &b};
+    const char *engineNames[2] = {"reference", "candidate"};
+    for(int e = 0; e < 2; e++)
+    {
+        unsigned long long full = engines[e]->computeStateHash();
+        if(engines[e]->stateHash() != full)
+        {
+            fprintf(out, "  hash   %s incremental %016llX recomputed %016llX\n",
+                    engineNames[e], engines[e]->stateHash(), full);
+        }
+    }
+    for(int p = 0; p < NUM_PLANES; p++)
+    {
+        for(int y = 0; y < HIRES_HEIGHT; y++)
+        {
+            for(int w = 0; w < GFX_ROW_WORDS; w++)
+            {
+                if(a.gfx[p][y][w] != b.gfx[p][y][w])
+                {
+                    fprintf(out, "  gfx plane %d row %2d word %d reference %016llX candidate %016llX\n",
+                            p, y, w, a.gfx[p][y][w], b.gfx[p][y][w]);
+                }
+            }
+        }
+    }
+}
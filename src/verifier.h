@@ -0,0 +1,56 @@
+#ifndef VERIFIER_H
+#define VERIFIER_H
+
+#include <stdio.h>
+#include "chip8.h"
+
+#define VERIFY_CYCLES_PER_FRAME 10
+#define VERIFY_CHECK_INTERVAL   100
+
+///< Where a candidate engine first left the reference
+struct verifyResult
+{
+    bool match;
+    unsigned long instructions; ///< Instructions run, up to and including the diverging one
+    unsigned long frame;
+    unsigned short pc;          ///< Reference PC and opcode of the diverging instruction
+    unsigned short opcode;
+};
+
+/**
+ * Runs the reference single step loop and the frame loop (the engine with
+ * fusion and any future fast paths) side by side on one ROM and one input
+ * script. Every checkInterval instructions the incremental state hashes are
+ * compared and a match is confirmed with hashes recomputed from scratch,
+ * which also catches a fast path that forgot to update a hash. On a mismatch both machines are replayed from boot to the
+ * last good check and stepped one instruction at a time to find the first
+ * diverging one, nothing is snapshotted while things agree.
+ */
+class chip8Verifier
+{
+    public:
+        chip8Verifier(int cyclesPerFrame = VERIFY_CYCLES_PER_FRAME, int checkInterval = VERIFY_CHECK_INTERVAL);
+
+        ///< Keys are a pseudo random script derived from seed, so a run is fully reproducible
+        verifyResult run(const unsigned char *rom, size_t size, QUIRKS_t quirks, unsigned long frames, unsigned int seed);
+        ///< Field by field difference of the two machines after a failed run
+        void printDiff(FILE *out) const;
+
+    private:
+        int cyclesPerFrame;
+        int checkInterval;
+        chip8 reference;
+        chip8 candidate;
+
+        void boot(const unsigned char *rom, size_t size, QUIRKS_t quirks, unsigned int seed);
+        static unsigned short scriptKeys(unsigned int seed, unsigned long frame);
+        static void setKeys(chip8 &c8, unsigned short mask);
+        ///< Same state, checked from scratch, and neither incremental hash has drifted
+        static bool agree(const chip8 &a, const chip8 &b);
+        void runReference(chip8 &c8, int cycles) const;
+        void runCandidate(chip8 &c8, int cycles) const;
+        void locate(const unsigned char *rom, size_t size, QUIRKS_t quirks, unsigned int seed,
+                    unsigned long lastGood, unsigned long failed, verifyResult &result);
+};
+
+#endif // VERIFIER_H
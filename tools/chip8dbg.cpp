@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include "chip8.h"
+#include "debugger.h"
+
+chip8 myChip8;
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		printf("Usage: ./chip8dbg <Rom Name> [modern|vip|chip48|schip|xochip]\n");
+		return 1;
+	}
+
+	QUIRKS_t quirks = (argc > 2) ? quirksFromName(argv[2]) : QUIRKS_MODERN;
+	if(quirks == NUM_QUIRKS)
+	{
+		printf("Unknown quirk profile: %s\n", argv[2]);
+		return 1;
+	}
+
+	if(!myChip8.loadGame(argv[1], quirks))
+	{
+		return 1;
+	}
+
+	chip8Debugger dbg(myChip8);
+	char line[256];
+
+	printf("Instance footprint: %zu bytes\n", myChip8.footprint());
+	dbg.printRegisters(stdout);
+	printf("> ");
+	fflush(stdout);
+	while(fgets(line, sizeof(line), stdin) != NULL)
+	{
+		if(!dbg.command(line, stdout))
+		{
+			break;
+		}
+		printf("> ");
+		fflush(stdout);
+	}
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "explorer.h"
+#include "romdb.h"
+
+#define DEFAULT_SECONDS     10
+
+static void usage()
+{
+	printf("Usage: ./chip8explore [-t seconds] [-j threads] [-b burst frames] [-g WxH] [-m addr,addr,...] [-s seed] [-r]\n"
+	       "                      <Rom Name> [modern|vip|chip48|schip|xochip]\n"
+	       "  -j  worker threads, 0 for every hardware thread\n"
+	       "  -s  seed for the boot state and the workers' random keys\n"
+	       "  -r  random play from boot without restoring cells, for comparison\n");
+}
+
+///< Whole decimal number no smaller than min
+static bool parseNumber(const char *text, int min, int &value)
+{
+	char *end;
+	long parsed = strtol(text, &end, 10);
+	if(end == text || *end != '\0' || parsed < min || parsed > 1000000)
+	{
+		return false;
+	}
+	value = (int)parsed;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	exploreConfig config;
+	int seconds = DEFAULT_SECONDS;
+	int opt;
+
+	while((opt = getopt(argc, argv, "t:j:b:g:m:s:r")) != -1)
+	{
+		switch(opt)
+		{
+			case 't':
+				if(!parseNumber(optarg, 1, seconds))
+				{
+					printf("Seconds must be a positive number\n");
+					return 1;
+				}
+			break;
+			case 'j':
+				if(!parseNumber(optarg, 0, config.numThreads))
+				{
+					printf("Threads must be 0 or more\n");
+					return 1;
+				}
+			break;
+			case 'b':
+				if(!parseNumber(optarg, 1, config.burstFrames))
+				{
+					printf("Burst frames must be a positive number\n");
+					return 1;
+				}
+			break;
+			case 's': config.seed = (unsigned int)strtoul(optarg, NULL, 0); break;
+			case 'r': config.restore = false; break;
+			case 'g':
+				if(sscanf(optarg, "%dx%d", &config.gridWidth, &config.gridHeight) != 2 ||
+				   config.gridWidth <= 0 || GFX_WIDTH % config.gridWidth ||
+				   config.gridHeight <= 0 || GFX_HEIGHT % config.gridHeight)
+				{
+					printf("Grid must divide 64x32\n");
+					return 1;
+				}
+			break;
+			case 'm':
+				for(char *item = strtok(optarg, ","); item != NULL; item = strtok(NULL, ","))
+				{
+					config.addresses.push_back((unsigned short)strtoul(item, NULL, 0));
+				}
+			break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+	if(optind >= argc)
+	{
+		usage();
+		return 1;
+	}
+
+	QUIRKS_t quirks = NUM_QUIRKS;
+	if(optind + 1 < argc)
+	{
+		quirks = quirksFromName(argv[optind + 1]);
+		if(quirks == NUM_QUIRKS)
+		{
+			printf("Unknown quirk profile: %s\n", argv[optind + 1]);
+			return 1;
+		}
+	}
+
+	romDatabase db;
+	db.load(getenv("CHIP8_ROMDB") ? getenv("CHIP8_ROMDB") : ROMDB_PATH);
+	romImage image;
+	if(!image.loadFile(argv[optind], &db, quirks))
+	{
+		printf("Cannot load %s\n", argv[optind]);
+		return 1;
+	}
+	config.cyclesPerFrame = image.info().cyclesPerFrame;
+
+	chip8 boot;
+	image.reset(boot);
+	boot.seedRandom(config.seed);
+	boot.setVerbose(false);
+
+	chip8Explorer explorer(boot, config);
+	printf("%s, %s, %s\n", argv[optind], quirksName(image.info().quirks),
+	       config.restore ? "restoring cells" : "random play from boot");
+	printf("%6s %9s %10s %6s %10s %8s\n", "time", "cells", "cells/s", "pcs", "frames/s", "depth");
+
+	explorer.start();
+	exploreStats last = explorer.stats();
+	for(int t = 0; t < seconds; t++)
+	{
+		sleep(1);
+		exploreStats now = explorer.stats();
+		double dt = now.seconds - last.seconds;
+		printf("%5.1fs %9lu %10.0f %6lu %10.0f %8lu\n", now.seconds, now.cells,
+		       (now.cells - last.cells) / dt, now.pcs, (now.frames - last.frames) / dt, now.maxDepth);
+		fflush(stdout);
+		last = now;
+	}
+	explorer.stop();
+
+	exploreStats s = explorer.stats();
+	printf("%lu cells in %.1fs, %.0f cells/s, %.0f frames/s, %lu pcs, deepest cell %lu frames from boot\n",
+	       s.cells, s.seconds, s.cells / s.seconds, s.frames / s.seconds, s.pcs, s.maxDepth);
+	if(s.dropped)
+	{
+		printf("Archive full, %lu new cells dropped\n", s.dropped);
+	}
+	return 0;
+}
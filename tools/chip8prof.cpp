@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "chip8.h"
+#include "profiler.h"
+#include "romdb.h"
+
+#define DEFAULT_FRAMES      3600
+///< Frames each random key is held for
+#define KEY_HOLD_FRAMES     8
+
+static void usage()
+{
+	printf("Usage: ./chip8prof [-f frames] [-s seed] [-o heatmap.ppm] <Rom Name> [modern|vip|chip48|schip|xochip]\n");
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long frames = DEFAULT_FRAMES;
+	unsigned int seed = 1;
+	const char *heatmap = NULL;
+	int opt;
+
+	while((opt = getopt(argc, argv, "f:s:o:")) != -1)
+	{
+		switch(opt)
+		{
+			case 'f': frames = strtoul(optarg, NULL, 0); break;
+			case 's': seed = (unsigned int)strtoul(optarg, NULL, 0); break;
+			case 'o': heatmap = optarg; break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+	if(optind >= argc)
+	{
+		usage();
+		return 1;
+	}
+
+	QUIRKS_t quirks = NUM_QUIRKS;
+	if(optind + 1 < argc)
+	{
+		quirks = quirksFromName(argv[optind + 1]);
+		if(quirks == NUM_QUIRKS)
+		{
+			printf("Unknown quirk profile: %s\n", argv[optind + 1]);
+			return 1;
+		}
+	}
+
+	///< Profile and speed come from the ROM database unless given
+	romDatabase db;
+	db.load(getenv("CHIP8_ROMDB") ? getenv("CHIP8_ROMDB") : ROMDB_PATH);
+	romImage image;
+	if(!image.loadFile(argv[optind], &db, quirks))
+	{
+		printf("Cannot load %s\n", argv[optind]);
+		return 1;
+	}
+
+	chip8 c8;
+	image.reset(c8);
+	c8.seedRandom(seed);
+	c8.setVerbose(false);
+	chip8Profiler profiler(c8);
+
+	///< One random key (or none) held for a few frames at a time
+	unsigned int keyState = seed ? seed : 1;
+	for(unsigned long f = 0; f < frames; f++)
+	{
+		if(f % KEY_HOLD_FRAMES == 0)
+		{
+			keyState ^= keyState << 13;
+			keyState ^= keyState >> 17;
+			keyState ^= keyState << 5;
+			int pressed = (int)(keyState % (KEYPAD_SIZE + 1)) - 1;
+			for(int k = 0; k < KEYPAD_SIZE; k++)
+			{
+				c8.key[k] = (k == pressed);
+			}
+		}
+		profiler.runFrame(image.info().cyclesPerFrame);
+	}
+
+	printf("%s, %lu frames\n", argv[optind], frames);
+	profiler.printReport(stdout);
+
+	if(heatmap != NULL)
+	{
+		if(!profiler.writeHeatmap(heatmap))
+		{
+			printf("Cannot write %s\n", heatmap);
+			return 1;
+		}
+		printf("Heat map written to %s\n", heatmap);
+	}
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "romdb.h"
+
+// Prints one database line per ROM, known ROMs as stored and unknown ones with
+// the defaults and the file name so they can be appended to the database
+int main(int argc, char** argv)
+{
+	const char *dbPath = getenv("CHIP8_ROMDB") ? getenv("CHIP8_ROMDB") : ROMDB_PATH;
+	int opt;
+
+	while((opt = getopt(argc, argv, "d:")) != -1)
+	{
+		switch(opt)
+		{
+			case 'd': dbPath = optarg; break;
+			default:
+				printf("Usage: ./chip8rom [-d database] <Rom>...\n");
+				return 1;
+		}
+	}
+	if(optind >= argc)
+	{
+		printf("Usage: ./chip8rom [-d database] <Rom>...\n");
+		return 1;
+	}
+
+	romDatabase db;
+	if(!db.load(dbPath))
+	{
+		fprintf(stderr, "No database at %s, every ROM is unknown\n", dbPath);
+	}
+
+	int failed = 0;
+	for(int i = optind; i < argc; i++)
+	{
+		romImage image;
+		if(!image.loadFile(argv[i], &db))
+		{
+			fprintf(stderr, "%s: cannot load\n", argv[i]);
+			failed++;
+			continue;
+		}
+
+		const romInfo &info = image.info();
+		const char *name = argv[i];
+		if(image.known())
+		{
+			name = info.name.c_str();
+		}
+		else if(strrchr(name, '/') != NULL)
+		{
+			name = strrchr(name, '/') + 1;
+		}
+
+		bool defaultKeys = !memcmp(info.keymap, ROMDB_DEFAULT_KEYMAP, KEYPAD_SIZE);
+		printf("%016llx %-7s %3d %-16.16s %s    # %zu bytes%s\n",
+		       info.hash, quirksName(info.quirks), info.cyclesPerFrame,
+		       defaultKeys ? "-" : info.keymap, name,
+		       image.size(), image.known() ? "" : ", not in the database");
+	}
+
+	return failed ? 1 : 0;
+}
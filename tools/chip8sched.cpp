@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+#include "scheduler.h"
+
+#define INPUT_INTERVAL_MS   100
+
+static void usage()
+{
+	printf("Usage: ./chip8sched [-n instances] [-j threads] [-t seconds] [-c cycles per frame] <Rom>...\n");
+}
+
+///< Whole decimal number no smaller than 1
+static bool parsePositive(const char *text, int &value)
+{
+	char *end;
+	long parsed = strtol(text, &end, 10);
+	if(end == text || *end != '\0' || parsed < 1 || parsed > 1000000)
+	{
+		return false;
+	}
+	value = (int)parsed;
+	return true;
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	int instances = 256;
+	int numThreads = 2;
+	int seconds = 10;
+	int cycles = SCHED_CYCLES_PER_FRAME;
+	bool valid;
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:j:t:c:")) != -1)
+	{
+		switch(opt)
+		{
+			case 'n': valid = parsePositive(optarg, instances); break;
+			case 'j': valid = parsePositive(optarg, numThreads); break;
+			case 't': valid = parsePositive(optarg, seconds); break;
+			case 'c': valid = parsePositive(optarg, cycles); break;
+			default: valid = false;
+		}
+		if(!valid)
+		{
+			usage();
+			printf("Counts must be positive numbers\n");
+			return 1;
+		}
+	}
+	if(optind >= argc)
+	{
+		usage();
+		return 1;
+	}
+
+	///< Each ROM is loaded once, its instances start from copies of the boot state
+	romDatabase db;
+	db.load(getenv("CHIP8_ROMDB") ? getenv("CHIP8_ROMDB") : ROMDB_PATH);
+	std::vector<romImage> images(argc - optind);
+	for(int i = optind; i < argc; i++)
+	{
+		if(!images[i - optind].loadFile(argv[i], &db))
+		{
+			printf("Cannot load %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	///< Instances are spread over the ROMs round robin
+	chip8Scheduler scheduler(numThreads, cycles);
+	for(int i = 0; i < instances; i++)
+	{
+		scheduler.add(images[i % images.size()]);
+	}
+
+	double cpuStart = cpuSeconds();
+	scheduler.start();
+
+	///< Players: every interval a few random instances press or release a key
+	unsigned int seed = 1;
+	for(int tick = 0; tick < seconds * 1000 / INPUT_INTERVAL_MS; tick++)
+	{
+		usleep(INPUT_INTERVAL_MS * 1000);
+		for(int i = 0; i < instances / 16 + 1; i++)
+		{
+			int id = rand_r(&seed) % instances;
+			unsigned short mask = (rand_r(&seed) & 1) ? (unsigned short)(1 << (rand_r(&seed) & 0xF)) : 0;
+			scheduler.setKeys(id, mask);
+		}
+		if((tick + 1) % (1000 / INPUT_INTERVAL_MS) == 0)
+		{
+			schedulerStats s = scheduler.stats();
+			printf("%3ds: %lu frames, %lu deadline misses, %lu skipped, %d parked\n",
+			       (tick + 1) * INPUT_INTERVAL_MS / 1000, s.frames, s.misses, s.skipped, s.parked);
+		}
+	}
+
+	scheduler.stop();
+	double cpu = cpuSeconds() - cpuStart;
+	schedulerStats s = scheduler.stats();
+
+	printf("%d instances on %d threads for %d s: %lu frames (%.1f per instance per second)\n",
+	       instances, numThreads, seconds, s.frames, (double)s.frames / instances / seconds);
+	printf("deadline misses %lu (worst %.0f us late), skipped %lu, wakeups %lu, parked %d, cpu %.1f%%\n",
+	       s.misses, s.maxLatenessUs, s.skipped, s.wakeups, s.parked, 100.0 * cpu / seconds);
+	return 0;
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "shmexport.h"
+
+#define POLL_US     16667
+
+static void printDisplay(const shmFrameData &f)
+{
+	int width = f.hires ? HIRES_WIDTH : GFX_WIDTH;
+	int height = f.hires ? HIRES_HEIGHT : GFX_HEIGHT;
+	char line[HIRES_WIDTH + 1];
+
+	for(int y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			unsigned long long bits = f.gfx[0][y][x >> 6] | f.gfx[1][y][x >> 6];
+			line[x] = ((bits >> (63 - (x & 63))) & 1) ? '#' : ' ';
+		}
+		line[width] = '\0';
+		printf("|%s|\n", line);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char *name = SHM_EXPORT_NAME;
+	bool draw = false;
+	long count = -1;
+	int opt;
+
+	while((opt = getopt(argc, argv, "dn:")) != -1)
+	{
+		switch(opt)
+		{
+			case 'd': draw = true; break;
+			case 'n': count = atol(optarg); break;
+			default:
+				printf("Usage: ./chip8shm [-d] [-n frames] [shm name]\n");
+				return 1;
+		}
+	}
+	if(optind < argc)
+	{
+		name = argv[optind];
+	}
+
+	shmReader reader;
+	if(!reader.open(name))
+	{
+		printf("Cannot open shared memory %s\n", name);
+		return 1;
+	}
+
+	shmFrameData f;
+	unsigned long long last = ~0ULL;
+	while(count != 0)
+	{
+		if(reader.readLatest(f) && f.frame != last)
+		{
+			printf("frame %llu PC=%03X", f.frame, f.pc);
+			for(int i = 0; i < REGISTER_SIZE; i++)
+			{
+				printf("%s%02X", i ? " " : " V=", f.V[i]);
+			}
+			printf(" | %.0f instr/s, frame %.0f us, %llu dropped%s\n",
+			       f.counters.instructionsPerSec, f.counters.frameTimeUs, f.counters.droppedFrames,
+			       (last != ~0ULL && f.frame > last + 1) ? " (skipped frames)" : "");
+			if(draw)
+			{
+				printDisplay(f);
+			}
+			last = f.frame;
+			if(count > 0)
+			{
+				count--;
+			}
+		}
+		usleep(POLL_US);
+	}
+	return 0;
+}
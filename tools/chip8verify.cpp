@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+#include "verifier.h"
+
+#define DEFAULT_FRAMES  3600
+
+struct verifyJob
+{
+	std::string romName;
+	std::vector<unsigned char> rom;
+	QUIRKS_t quirks;
+	bool skipped;
+	verifyResult result;
+	std::string diff;
+};
+
+static bool readRom(const char *romName, std::vector<unsigned char> &rom)
+{
+	FILE *fptr = fopen(romName, "rb");
+	if(fptr == NULL)
+	{
+		return false;
+	}
+	int c;
+	while((c = fgetc(fptr)) != EOF)
+	{
+		rom.push_back((unsigned char)c);
+	}
+	fclose(fptr);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long frames = DEFAULT_FRAMES;
+	int cycles = VERIFY_CYCLES_PER_FRAME;
+	int interval = VERIFY_CHECK_INTERVAL;
+	unsigned int seed = 1;
+	int numThreads = std::thread::hardware_concurrency();
+	QUIRKS_t only = NUM_QUIRKS;
+	int opt;
+
+	while((opt = getopt(argc, argv, "f:c:n:s:j:q:")) != -1)
+	{
+		switch(opt)
+		{
+			case 'f': frames = strtoul(optarg, NULL, 0); break;
+			case 'c': cycles = atoi(optarg); break;
+			case 'n': interval = atoi(optarg); break;
+			case 's': seed = strtoul(optarg, NULL, 0); break;
+			case 'j': numThreads = atoi(optarg); break;
+			case 'q':
+				only = quirksFromName(optarg);
+				if(only == NUM_QUIRKS)
+				{
+					printf("Unknown quirk profile: %s\n", optarg);
+					return 1;
+				}
+			break;
+			default:
+				optind = argc;
+		}
+	}
+
+	if(optind >= argc || cycles < 1 || interval < 1)
+	{
+		printf("Usage: ./chip8verify [-f frames] [-c cycles per frame] [-n check interval] [-s seed]\n"
+		       "                     [-j threads] [-q modern|vip|chip48|schip|xochip] <Rom>...\n");
+		return 1;
+	}
+
+	///< One job per ROM and quirk profile, every profile has its own compiled loop
+	std::vector<verifyJob> jobs;
+	for(int i = optind; i < argc; i++)
+	{
+		std::vector<unsigned char> rom;
+		if(!readRom(argv[i], rom))
+		{
+			printf("File Error: %s\n", argv[i]);
+			return 1;
+		}
+		for(int q = 0; q < NUM_QUIRKS; q++)
+		{
+			if(only != NUM_QUIRKS && q != only)
+			{
+				continue;
+			}
+			verifyJob job;
+			job.romName = argv[i];
+			job.rom = rom;
+			job.quirks = (QUIRKS_t)q;
+			job.skipped = rom.size() > ((q == QUIRKS_XOCHIP) ? XO_MAX_ROM_SIZE : MAX_ROM_SIZE);
+			jobs.push_back(job);
+		}
+	}
+
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	if(numThreads < 1)
+	{
+		numThreads = 1;
+	}
+	for(int t = 0; t < numThreads; t++)
+	{
+		workers.push_back(std::thread([&]() {
+			chip8Verifier verifier(cycles, interval);
+			for(size_t j = next++; j < jobs.size(); j = next++)
+			{
+				verifyJob &job = jobs[j];
+				if(job.skipped)
+				{
+					continue;
+				}
+				const unsigned char *data = job.rom.empty() ? NULL : &job.rom[0];
+				job.result = verifier.run(data, job.rom.size(), job.quirks, frames, seed);
+				if(!job.result.match)
+				{
+					char *text = NULL;
+					size_t length = 0;
+					FILE *out = open_memstream(&text, &length);
+					verifier.printDiff(out);
+					fclose(out);
+					job.diff.assign(text, length);
+					free(text);
+				}
+			}
+		}));
+	}
+	for(size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+
+	int failures = 0;
+	for(size_t j = 0; j < jobs.size(); j++)
+	{
+		const verifyJob &job = jobs[j];
+		if(job.skipped)
+		{
+			printf("SKIP %-7s %s (too large)\n", quirksName(job.quirks), job.romName.c_str());
+		}
+		else if(job.result.match)
+		{
+			printf("PASS %-7s %s (%lu instructions)\n", quirksName(job.quirks), job.romName.c_str(), job.result.instructions);
+		}
+		else
+		{
+			failures++;
+			printf("FAIL %-7s %s: instruction %lu (frame %lu) PC=%03X OP=%04X\n%s",
+			       quirksName(job.quirks), job.romName.c_str(), job.result.instructions,
+			       job.result.frame, job.result.pc, job.result.opcode, job.diff.c_str());
+		}
+	}
+
+	printf("%d of %d runs diverged\n", failures, (int)jobs.size());
+	return failures ? 1 : 0;
+}